@@ -61,3 +61,20 @@ foreach(TEST_SOURCE ${TEST_SOURCES})
       $<TARGET_FILE:${TEST_NAME}>)
   endif()
 endforeach()
+
+file(GLOB BENCH_SOURCES "tests/bench_*.c")
+
+foreach(BENCH_SOURCE ${BENCH_SOURCES})
+  get_filename_component(BENCH_NAME ${BENCH_SOURCE} NAME_WE)
+  set(BENCH_NAME "lierre_${BENCH_NAME}")
+
+  add_executable(${BENCH_NAME} ${BENCH_SOURCE})
+
+  target_link_libraries(${BENCH_NAME} PRIVATE lierre)
+
+  target_include_directories(${BENCH_NAME} PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+
+  set_target_properties(${BENCH_NAME} PROPERTIES
+    RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/tests
+  )
+endforeach()
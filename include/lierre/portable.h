@@ -22,6 +22,11 @@ extern "C" {
 #include <windows.h>
 
 typedef HANDLE lierre_thread_t;
+typedef CRITICAL_SECTION lierre_mutex_t;
+typedef CONDITION_VARIABLE lierre_cond_t;
+typedef INIT_ONCE lierre_once_t;
+
+#define LIERRE_ONCE_INIT INIT_ONCE_STATIC_INIT
 
 typedef struct {
     void *(*start_routine)(void *);
@@ -33,14 +38,45 @@ typedef struct {
 #include <pthread.h>
 
 typedef pthread_t lierre_thread_t;
+typedef pthread_mutex_t lierre_mutex_t;
+typedef pthread_cond_t lierre_cond_t;
+typedef pthread_once_t lierre_once_t;
+
+#define LIERRE_ONCE_INIT PTHREAD_ONCE_INIT
 
 #endif
 
+typedef struct _lierre_thread_pool_t lierre_thread_pool_t;
+
+typedef void (*lierre_thread_pool_task_t)(void *arg, uint32_t index);
+
 uint32_t lierre_get_cpu_count(void);
 
 int lierre_thread_create(lierre_thread_t *thread, void *(*start_routine)(void *), void *arg);
 int lierre_thread_join(lierre_thread_t thread, void **retval);
 
+int lierre_mutex_init(lierre_mutex_t *mutex);
+void lierre_mutex_destroy(lierre_mutex_t *mutex);
+int lierre_mutex_lock(lierre_mutex_t *mutex);
+int lierre_mutex_unlock(lierre_mutex_t *mutex);
+
+int lierre_cond_init(lierre_cond_t *cond);
+void lierre_cond_destroy(lierre_cond_t *cond);
+int lierre_cond_wait(lierre_cond_t *cond, lierre_mutex_t *mutex);
+int lierre_cond_signal(lierre_cond_t *cond);
+int lierre_cond_broadcast(lierre_cond_t *cond);
+
+int lierre_once(lierre_once_t *once, void (*init_routine)(void));
+
+uint32_t lierre_atomic_load(volatile uint32_t *value);
+void lierre_atomic_store(volatile uint32_t *value, uint32_t desired);
+uint32_t lierre_atomic_fetch_add(volatile uint32_t *value, uint32_t delta);
+
+lierre_thread_pool_t *lierre_thread_pool_create(uint32_t num_threads);
+void lierre_thread_pool_destroy(lierre_thread_pool_t *pool);
+uint32_t lierre_thread_pool_get_num_threads(const lierre_thread_pool_t *pool);
+int lierre_thread_pool_run(lierre_thread_pool_t *pool, lierre_thread_pool_task_t task, void *arg, uint32_t num_tasks);
+
 #ifdef __cplusplus
 }
 #endif
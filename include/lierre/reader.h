@@ -25,16 +25,47 @@
 #define LIERRE_READER_STRATEGY_CONTRAST_NORMALIZE   (1 << 6) /* normalize contrast */
 #define LIERRE_READER_STRATEGY_SHARPENING           (1 << 7) /* apply sharpening filter */
 #define LIERRE_READER_STRATEGY_MT                   (1 << 8) /* use multi-threading */
+#define LIERRE_READER_STRATEGY_LAZY_REFINE          (1 << 9) /* refine perspective only when decoding fails */
+
+#define LIERRE_READER_LIMIT_NONE        0
+#define LIERRE_READER_LIMIT_REGION_AREA (1 << 0) /* a region larger than max_region_area was skipped */
+#define LIERRE_READER_LIMIT_REGIONS     (1 << 1) /* the region table could not grow */
+#define LIERRE_READER_LIMIT_CANDIDATES  (1 << 2) /* finder candidates beyond max_candidates were dropped */
+#define LIERRE_READER_LIMIT_CAPSTONES   (1 << 3) /* the capstone table could not grow */
+#define LIERRE_READER_LIMIT_GRIDS       (1 << 4) /* grids dropped at max_grids or on grid/lattice allocation failure */
+#define LIERRE_READER_LIMIT_REFINEMENT  (1 << 5) /* perspective refinement stopped at max_refine_steps */
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef uint16_t lierre_reader_strategy_flag_t;
+typedef uint16_t lierre_reader_limit_flag_t;
+
+typedef void (*lierre_reader_task_t)(void *task_arg, uint32_t index);
+
+/*
+ * Runs task(task_arg, index) once for every index in [0, num_tasks), on any thread and in any order, and returns only
+ * after all of them have finished. Running them inline on the calling thread is valid.
+ */
+typedef void (*lierre_reader_executor_t)(void *executor_ctx, lierre_reader_task_t task, void *task_arg,
+                                         uint32_t num_tasks);
+
+/* Per-frame work caps for pathological input. Zero leaves a cap unlimited. */
+typedef struct {
+    uint32_t max_region_area;  /* pixels in one connected region */
+    uint32_t max_candidates;   /* finder candidates tested for a capstone */
+    uint32_t max_grids;        /* capstone triples turned into grids */
+    uint32_t max_refine_steps; /* grid fitness evaluations spent on perspective refinement */
+} lierre_reader_limits_t;
 
 typedef struct {
     lierre_reader_strategy_flag_t strategy_flags;
     const lierre_rect_t *rect;
+    lierre_reader_executor_t executor;
+    void *executor_ctx;
+    uint32_t max_parallelism;
+    lierre_reader_limits_t limits;
 } lierre_reader_param_t;
 typedef struct _lierre_reader_t lierre_reader_t;
 typedef struct _lierre_reader_result_t lierre_reader_result_t;
@@ -42,11 +73,17 @@ typedef struct _lierre_reader_result_t lierre_reader_result_t;
 lierre_error_t lierre_reader_param_init(lierre_reader_param_t *param);
 void lierre_reader_param_set_flag(lierre_reader_param_t *param, lierre_reader_strategy_flag_t flag);
 void lierre_reader_param_set_rect(lierre_reader_param_t *param, const lierre_rect_t *rect);
+void lierre_reader_param_set_executor(lierre_reader_param_t *param, lierre_reader_executor_t executor,
+                                      void *executor_ctx);
+void lierre_reader_param_set_max_parallelism(lierre_reader_param_t *param, uint32_t max_parallelism);
+void lierre_reader_param_set_limits(lierre_reader_param_t *param, const lierre_reader_limits_t *limits);
 
 lierre_reader_t *lierre_reader_create(const lierre_reader_param_t *param);
 void lierre_reader_destroy(lierre_reader_t *reader);
 void lierre_reader_set_data(lierre_reader_t *reader, lierre_rgb_data_t *data);
 lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_result_t **result);
+lierre_error_t lierre_reader_read_batch(lierre_reader_t *reader, lierre_rgb_data_t **images, size_t num_images,
+                                        lierre_reader_result_t **results);
 
 void lierre_reader_result_destroy(lierre_reader_result_t *result);
 uint32_t lierre_reader_result_get_num_qr_codes(const lierre_reader_result_t *result);
@@ -54,6 +91,16 @@ const lierre_rect_t *lierre_reader_result_get_qr_code_rect(const lierre_reader_r
 const uint8_t *lierre_reader_result_get_qr_code_data(const lierre_reader_result_t *result, uint32_t index);
 size_t lierre_reader_result_get_qr_code_data_size(const lierre_reader_result_t *result, uint32_t index);
 
+/*
+ * Finder pattern candidates seen while reading, and how many of them failed the vertical cross-check before any
+ * region was built. Both are summed over every scale tried by LIERRE_READER_STRATEGY_MINIMIZE.
+ */
+uint32_t lierre_reader_result_get_num_finder_candidates(const lierre_reader_result_t *result);
+uint32_t lierre_reader_result_get_num_finder_rejected(const lierre_reader_result_t *result);
+
+/* LIERRE_READER_LIMIT_* bits for every cap that cut work short while reading. */
+lierre_reader_limit_flag_t lierre_reader_result_get_limits_hit(const lierre_reader_result_t *result);
+
 #ifdef __cplusplus
 }
 #endif
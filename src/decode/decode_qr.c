@@ -14,6 +14,7 @@
 #include <poporon.h>
 
 #include "../internal/decoder.h"
+#include "../internal/simd.h"
 
 #define FORMAT_BITS_COUNT      15
 #define FORMAT_XOR_MASK        0x5412
@@ -25,6 +26,17 @@
 #define FORMAT_BCH_GEN_POLY     0x13
 #define FORMAT_BCH_CORRECTION_T 3
 
+#define RS_SYMBOL_SIZE    8
+#define RS_GEN_POLY       0x11D
+#define RS_FIRST_ROOT     0
+#define RS_PRIMITIVE_ELEM 1
+#define RS_MAX_PARITY     30
+#define RS_MAX_BLOCKS     81
+#define RS_GF256_ALPHA    0x2
+#define RS_NIBBLE_SIZE    16
+#define RS_NIBBLE_MASK    0x0F
+#define RS_NIBBLE_SHIFT   4
+
 #define FINDER_PATTERN_SIZE        7
 #define FINDER_EDGE_SIZE           8
 #define FINDER_CENTER              9
@@ -64,6 +76,130 @@
 #define KANJI_BITS_LARGE   12
 #define KANJI_ENCODED_BITS 13
 
+#define DATA_LAYOUT_MASK_COUNT 8
+#define DATA_LAYOUT_WORD_BITS  64
+
+typedef struct {
+    lierre_mutex_t lock;
+    poporon_config_t *config;
+    poporon_t *pprn;
+} codec_cache_entry_t;
+
+typedef struct {
+    uint8_t mul_lo[RS_MAX_PARITY][RS_NIBBLE_SIZE];
+    uint8_t mul_hi[RS_MAX_PARITY][RS_NIBBLE_SIZE];
+} syndrome_tables_t;
+
+typedef struct {
+    uint16_t *cells;
+    uint8_t *mask_planes;
+    int32_t num_bits;
+    int32_t num_bytes;
+    volatile uint32_t ready;
+} data_layout_t;
+
+static codec_cache_entry_t format_codec;
+static codec_cache_entry_t rs_codecs[RS_MAX_PARITY + 1];
+static syndrome_tables_t syndrome_tables;
+static lierre_once_t codec_cache_once = LIERRE_ONCE_INIT;
+static data_layout_t data_layouts[LIERRE_DECODER_MAX_VERSION + 1];
+static lierre_mutex_t data_layout_lock;
+static bool data_layout_lock_ready;
+static lierre_once_t data_layout_once = LIERRE_ONCE_INIT;
+
+static inline uint8_t gf256_multiply(uint8_t x, uint8_t y)
+{
+    uint32_t result;
+    int32_t i;
+
+    result = 0;
+    for (i = 7; i >= 0; i--) {
+        result = (result << 1) ^ ((result >> 7) * RS_GEN_POLY);
+        result ^= ((y >> i) & 1) * x;
+    }
+
+    return (uint8_t)result;
+}
+
+static inline void syndrome_tables_init(void)
+{
+    uint8_t root;
+    int32_t power, i;
+
+    root = 1;
+    for (power = 0; power < RS_MAX_PARITY; power++) {
+        for (i = 0; i < RS_NIBBLE_SIZE; i++) {
+            syndrome_tables.mul_lo[power][i] = gf256_multiply(root, (uint8_t)i);
+            syndrome_tables.mul_hi[power][i] = gf256_multiply(root, (uint8_t)(i << RS_NIBBLE_SHIFT));
+        }
+        root = gf256_multiply(root, RS_GF256_ALPHA);
+    }
+}
+
+static inline void codec_cache_entry_init(codec_cache_entry_t *entry, poporon_config_t *config)
+{
+    if (!config) {
+        return;
+    }
+
+    entry->pprn = poporon_create(config);
+    if (!entry->pprn) {
+        poporon_config_destroy(config);
+        return;
+    }
+
+    if (lierre_mutex_init(&entry->lock) != 0) {
+        poporon_destroy(entry->pprn);
+        poporon_config_destroy(config);
+        entry->pprn = NULL;
+        return;
+    }
+
+    entry->config = config;
+}
+
+static void codec_cache_init(void)
+{
+    const rs_params_t *ecc;
+    poporon_config_t *config;
+    int32_t version, level, parity;
+
+    syndrome_tables_init();
+
+    config = poporon_bch_config_create(FORMAT_BCH_SYMBOL_SIZE, FORMAT_BCH_GEN_POLY, FORMAT_BCH_CORRECTION_T);
+    codec_cache_entry_init(&format_codec, config);
+
+    for (version = 1; version <= LIERRE_DECODER_MAX_VERSION; version++) {
+        for (level = 0; level < 4; level++) {
+            ecc = &lierre_version_db[version].ecc[level];
+            parity = ecc->bs - ecc->dw;
+            if (parity <= 0 || parity > RS_MAX_PARITY || rs_codecs[parity].pprn) {
+                continue;
+            }
+
+            config = poporon_rs_config_create(RS_SYMBOL_SIZE, RS_GEN_POLY, RS_FIRST_ROOT, RS_PRIMITIVE_ELEM,
+                                              (uint8_t)parity, NULL, NULL);
+            codec_cache_entry_init(&rs_codecs[parity], config);
+        }
+    }
+}
+
+static inline bool codec_cache_decode(codec_cache_entry_t *entry, uint8_t *data, size_t size, uint8_t *parity)
+{
+    size_t corrected;
+    bool success;
+
+    if (!entry->pprn) {
+        return false;
+    }
+
+    lierre_mutex_lock(&entry->lock);
+    success = poporon_decode(entry->pprn, data, size, parity, &corrected);
+    lierre_mutex_unlock(&entry->lock);
+
+    return success;
+}
+
 static inline int32_t grid_bit(const qr_code_t *code, int32_t x, int32_t y)
 {
     int32_t bit_position;
@@ -74,19 +210,9 @@ static inline int32_t grid_bit(const qr_code_t *code, int32_t x, int32_t y)
 
 static inline lierre_error_t correct_format_bits(uint16_t *format_bits)
 {
-    poporon_config_t *config;
-    poporon_t *pprn;
     uint8_t data[1], parity[2];
-    size_t corrected;
 
-    config = poporon_bch_config_create(FORMAT_BCH_SYMBOL_SIZE, FORMAT_BCH_GEN_POLY, FORMAT_BCH_CORRECTION_T);
-    if (!config) {
-        return LIERRE_ERROR_FORMAT_ECC;
-    }
-
-    pprn = poporon_create(config);
-    if (!pprn) {
-        poporon_config_destroy(config);
+    if (lierre_once(&codec_cache_once, codec_cache_init) != 0) {
         return LIERRE_ERROR_FORMAT_ECC;
     }
 
@@ -94,15 +220,10 @@ static inline lierre_error_t correct_format_bits(uint16_t *format_bits)
     parity[0] = (uint8_t)((*format_bits >> 8) & 0x03);
     parity[1] = (uint8_t)(*format_bits & 0xFF);
 
-    if (!poporon_decode(pprn, data, 1, parity, &corrected)) {
-        poporon_destroy(pprn);
-        poporon_config_destroy(config);
+    if (!codec_cache_decode(&format_codec, data, 1, parity)) {
         return LIERRE_ERROR_FORMAT_ECC;
     }
 
-    poporon_destroy(pprn);
-    poporon_config_destroy(config);
-
     *format_bits = (uint16_t)((data[0] << 10) | (parity[0] << 8) | parity[1]);
 
     return LIERRE_ERROR_SUCCESS;
@@ -240,81 +361,374 @@ static inline int32_t is_reserved_cell(int32_t version, int32_t row, int32_t col
     return 0;
 }
 
-static inline void read_bit(const qr_code_t *code, qr_data_t *data, datastream_t *ds, int32_t row, int32_t col)
+static inline int32_t data_layout_walk(int32_t version, uint16_t *cells)
 {
-    int32_t bit_offset, byte_offset, value;
-
-    bit_offset = ds->data_bits & 7;
-    byte_offset = ds->data_bits >> 3;
-    value = grid_bit(code, col, row);
-
-    if (mask_bit(data->mask, row, col)) {
-        value ^= 1;
-    }
-
-    if (value) {
-        ds->raw[byte_offset] |= (0x80 >> bit_offset);
-    }
+    int32_t size, row, col, direction, count;
 
-    ds->data_bits++;
-}
-
-static inline void read_data(const qr_code_t *code, qr_data_t *data, datastream_t *ds)
-{
-    int32_t row, col, direction;
-
-    row = code->size - 1;
-    col = code->size - 1;
+    size = version * 4 + QR_VERSION1_SIZE;
+    row = size - 1;
+    col = size - 1;
     direction = -1;
+    count = 0;
 
     while (col > 0) {
-        if (col == 6) {
+        if (col == TIMING_PATTERN_POSITION) {
             col--;
         }
 
-        if (!is_reserved_cell(data->version, row, col)) {
-            read_bit(code, data, ds, row, col);
+        if (!is_reserved_cell(version, row, col)) {
+            cells[count++] = (uint16_t)(row * size + col);
         }
 
-        if (!is_reserved_cell(data->version, row, col - 1)) {
-            read_bit(code, data, ds, row, col - 1);
+        if (!is_reserved_cell(version, row, col - 1)) {
+            cells[count++] = (uint16_t)(row * size + col - 1);
         }
 
         row += direction;
-        if (row < 0 || row >= code->size) {
+        if (row < 0 || row >= size) {
             direction = -direction;
             col -= 2;
             row += direction;
         }
     }
+
+    return count;
 }
 
-static inline lierre_error_t correct_block_with_poporon(uint8_t *block_data, const rs_params_t *ecc_params)
+static inline bool data_layout_build(data_layout_t *layout, int32_t version)
 {
-    poporon_t *rs_decoder;
-    poporon_config_t *config;
-    int32_t parity_bytes;
-    size_t corrected;
-    bool success;
+    uint16_t *cells;
+    uint8_t *mask_planes, *plane;
+    int32_t size, num_bits, num_bytes, mask, i;
 
-    parity_bytes = ecc_params->bs - ecc_params->dw;
+    size = version * 4 + QR_VERSION1_SIZE;
 
-    config = poporon_rs_config_create(8, 0x11D, 0, 1, (uint8_t)parity_bytes, NULL, NULL);
-    if (!config) {
-        return LIERRE_ERROR_DATA_ECC;
+    cells = lmalloc((size_t)size * (size_t)size * sizeof(uint16_t));
+    if (!cells) {
+        return false;
     }
 
-    rs_decoder = poporon_create(config);
-    if (!rs_decoder) {
-        poporon_config_destroy(config);
-        return LIERRE_ERROR_DATA_ECC;
+    num_bits = data_layout_walk(version, cells);
+    num_bytes = (num_bits + DATA_LAYOUT_WORD_BITS - 1) / DATA_LAYOUT_WORD_BITS * (DATA_LAYOUT_WORD_BITS / 8);
+
+    mask_planes = lcalloc(DATA_LAYOUT_MASK_COUNT, (size_t)num_bytes);
+    if (!mask_planes) {
+        lfree(cells);
+        return false;
+    }
+
+    for (mask = 0; mask < DATA_LAYOUT_MASK_COUNT; mask++) {
+        plane = mask_planes + (size_t)mask * (size_t)num_bytes;
+        for (i = 0; i < num_bits; i++) {
+            if (mask_bit(mask, cells[i] / size, cells[i] % size)) {
+                plane[i >> 3] |= (uint8_t)(0x80 >> (i & 7));
+            }
+        }
+    }
+
+    layout->cells = cells;
+    layout->mask_planes = mask_planes;
+    layout->num_bits = num_bits;
+    layout->num_bytes = num_bytes;
+
+    return true;
+}
+
+static void data_layout_lock_init(void)
+{
+    data_layout_lock_ready = lierre_mutex_init(&data_layout_lock) == 0;
+}
+
+/*
+ * Tables are built on first use of a version and shared by every decoder for the lifetime of the process. A built
+ * table is published through its ready flag with release/acquire ordering, so only the build path takes the lock.
+ */
+static inline const data_layout_t *get_data_layout(int32_t version)
+{
+    data_layout_t *layout;
+    bool ready;
+
+    layout = &data_layouts[version];
+    if (lierre_atomic_load(&layout->ready)) {
+        return layout;
+    }
+
+    if (lierre_once(&data_layout_once, data_layout_lock_init) != 0 || !data_layout_lock_ready) {
+        return NULL;
+    }
+
+    lierre_mutex_lock(&data_layout_lock);
+    ready = layout->cells || data_layout_build(layout, version);
+    if (ready) {
+        lierre_atomic_store(&layout->ready, 1);
+    }
+    lierre_mutex_unlock(&data_layout_lock);
+
+    return ready ? layout : NULL;
+}
+
+/*
+ * Gathers the data modules in codeword order, eight to a byte, then removes the mask by XOR against the version's
+ * precomputed plane for it a word at a time. Plane bits past num_bits are zero, so the padding stays clear.
+ */
+static inline lierre_error_t read_data(const qr_code_t *code, qr_data_t *data, datastream_t *ds)
+{
+    const data_layout_t *layout;
+    const uint16_t *cells;
+    const uint8_t *plane;
+    uint64_t word, mask_word;
+    uint32_t value;
+    int32_t i, j;
+
+    layout = get_data_layout(data->version);
+    if (!layout) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
+    }
+
+    cells = layout->cells;
+    for (i = 0; i + 8 <= layout->num_bits; i += 8) {
+        value = 0;
+        for (j = 0; j < 8; j++) {
+            value = (value << 1) | ((code->cell_bitmap[cells[i + j] >> 3] >> (cells[i + j] & 7)) & 1);
+        }
+        ds->raw[i >> 3] = (uint8_t)value;
+    }
+
+    for (; i < layout->num_bits; i++) {
+        ds->raw[i >> 3] |= (uint8_t)(((code->cell_bitmap[cells[i] >> 3] >> (cells[i] & 7)) & 1) << (7 - (i & 7)));
+    }
+
+    plane = layout->mask_planes + (size_t)data->mask * (size_t)layout->num_bytes;
+    for (i = 0; i < layout->num_bytes; i += (int32_t)sizeof(word)) {
+        lmemcpy(&word, ds->raw + i, sizeof(word));
+        lmemcpy(&mask_word, plane + i, sizeof(mask_word));
+        word ^= mask_word;
+        lmemcpy(ds->raw + i, &word, sizeof(word));
     }
 
-    success = poporon_decode(rs_decoder, block_data, (size_t)ecc_params->dw, &block_data[ecc_params->dw], &corrected);
-    poporon_destroy(rs_decoder);
-    poporon_config_destroy(config);
+    ds->data_bits = layout->num_bits;
+
+    return LIERRE_ERROR_SUCCESS;
+}
+
+#if LIERRE_USE_SIMD && defined(LIERRE_SIMD_AVX2)
+static inline __m256i gf256_multiply_avx2(__m256i value, __m256i lo_table, __m256i hi_table, __m256i nibble_mask)
+{
+    __m256i lo, hi;
+
+    lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(value, nibble_mask));
+    hi = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(value, RS_NIBBLE_SHIFT), nibble_mask));
+
+    return _mm256_xor_si256(lo, hi);
+}
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_NEON)
+static inline uint8x16_t gf256_multiply_neon(uint8x16_t value, uint8x16_t lo_table, uint8x16_t hi_table)
+{
+    uint8x16_t lo, hi;
+
+    lo = vqtbl1q_u8(lo_table, vandq_u8(value, vdupq_n_u8(RS_NIBBLE_MASK)));
+    hi = vqtbl1q_u8(hi_table, vshrq_n_u8(value, RS_NIBBLE_SHIFT));
 
-    if (!success) {
+    return veorq_u8(lo, hi);
+}
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_WASM)
+static inline v128_t gf256_multiply_wasm(v128_t value, v128_t lo_table, v128_t hi_table)
+{
+    v128_t lo, hi;
+
+    lo = wasm_i8x16_swizzle(lo_table, wasm_v128_and(value, wasm_i8x16_splat(RS_NIBBLE_MASK)));
+    hi = wasm_i8x16_swizzle(hi_table, wasm_u8x16_shr(value, RS_NIBBLE_SHIFT));
+
+    return wasm_v128_xor(lo, hi);
+}
+#endif
+
+/*
+ * The raw codestream is already interleaved, so row t holds byte t of every block and the Horner steps of one
+ * syndrome run across blocks in parallel. Long blocks carry one extra data byte stored after the common data rows.
+ * dirty[i] is set to the OR of all syndromes of block i, which is zero only for a valid codeword.
+ */
+static inline void compute_block_syndromes(const uint8_t *raw, int32_t total_blocks, int32_t short_blocks,
+                                           int32_t data_words, int32_t parity, int32_t ecc_offset, uint8_t *dirty)
+{
+    const uint8_t *extra;
+    int32_t base, power, row;
+
+    extra = raw + data_words * total_blocks - short_blocks;
+
+#if LIERRE_USE_SIMD && defined(LIERRE_SIMD_AVX2)
+    {
+        __m256i syndrome, accum, lo_table, hi_table, nibble_mask, long_mask, lanes, product;
+        uint8_t result[32];
+        int32_t lane;
+
+        nibble_mask = _mm256_set1_epi8(RS_NIBBLE_MASK);
+        lanes = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+                                 24, 25, 26, 27, 28, 29, 30, 31);
+
+        for (base = 0; base < total_blocks; base += 32) {
+            long_mask = _mm256_cmpgt_epi8(lanes, _mm256_set1_epi8((char)(short_blocks - base - 1)));
+            accum = _mm256_setzero_si256();
+
+            for (power = 0; power < parity; power++) {
+                lo_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)syndrome_tables.mul_lo[power]));
+                hi_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)syndrome_tables.mul_hi[power]));
+                syndrome = _mm256_setzero_si256();
+
+                for (row = 0; row < data_words; row++) {
+                    syndrome = _mm256_xor_si256(
+                        gf256_multiply_avx2(syndrome, lo_table, hi_table, nibble_mask),
+                        _mm256_loadu_si256((const __m256i *)(raw + row * total_blocks + base)));
+                }
+
+                product = _mm256_xor_si256(gf256_multiply_avx2(syndrome, lo_table, hi_table, nibble_mask),
+                                           _mm256_loadu_si256((const __m256i *)(extra + base)));
+                syndrome = _mm256_blendv_epi8(syndrome, product, long_mask);
+
+                for (row = 0; row < parity; row++) {
+                    syndrome = _mm256_xor_si256(
+                        gf256_multiply_avx2(syndrome, lo_table, hi_table, nibble_mask),
+                        _mm256_loadu_si256((const __m256i *)(raw + ecc_offset + row * total_blocks + base)));
+                }
+
+                accum = _mm256_or_si256(accum, syndrome);
+            }
+
+            _mm256_storeu_si256((__m256i *)result, accum);
+            for (lane = 0; lane < 32 && base + lane < total_blocks; lane++) {
+                dirty[base + lane] = result[lane];
+            }
+        }
+    }
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_NEON)
+    {
+        static const int8_t lane_index[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+        uint8x16_t syndrome, accum, lo_table, hi_table, long_mask, product;
+        int8x16_t lanes;
+        uint8_t result[16];
+        int32_t lane;
+
+        lanes = vld1q_s8(lane_index);
+
+        for (base = 0; base < total_blocks; base += 16) {
+            long_mask = vcgtq_s8(lanes, vdupq_n_s8((int8_t)(short_blocks - base - 1)));
+            accum = vdupq_n_u8(0);
+
+            for (power = 0; power < parity; power++) {
+                lo_table = vld1q_u8(syndrome_tables.mul_lo[power]);
+                hi_table = vld1q_u8(syndrome_tables.mul_hi[power]);
+                syndrome = vdupq_n_u8(0);
+
+                for (row = 0; row < data_words; row++) {
+                    syndrome = veorq_u8(gf256_multiply_neon(syndrome, lo_table, hi_table),
+                                        vld1q_u8(raw + row * total_blocks + base));
+                }
+
+                product = veorq_u8(gf256_multiply_neon(syndrome, lo_table, hi_table), vld1q_u8(extra + base));
+                syndrome = vbslq_u8(long_mask, product, syndrome);
+
+                for (row = 0; row < parity; row++) {
+                    syndrome = veorq_u8(gf256_multiply_neon(syndrome, lo_table, hi_table),
+                                        vld1q_u8(raw + ecc_offset + row * total_blocks + base));
+                }
+
+                accum = vorrq_u8(accum, syndrome);
+            }
+
+            vst1q_u8(result, accum);
+            for (lane = 0; lane < 16 && base + lane < total_blocks; lane++) {
+                dirty[base + lane] = result[lane];
+            }
+        }
+    }
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_WASM)
+    {
+        v128_t syndrome, accum, lo_table, hi_table, long_mask, lanes, product;
+        uint8_t result[16];
+        int32_t lane;
+
+        lanes = wasm_i8x16_make(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+        for (base = 0; base < total_blocks; base += 16) {
+            long_mask = wasm_i8x16_gt(lanes, wasm_i8x16_splat((int8_t)(short_blocks - base - 1)));
+            accum = wasm_i8x16_splat(0);
+
+            for (power = 0; power < parity; power++) {
+                lo_table = wasm_v128_load(syndrome_tables.mul_lo[power]);
+                hi_table = wasm_v128_load(syndrome_tables.mul_hi[power]);
+                syndrome = wasm_i8x16_splat(0);
+
+                for (row = 0; row < data_words; row++) {
+                    syndrome = wasm_v128_xor(gf256_multiply_wasm(syndrome, lo_table, hi_table),
+                                             wasm_v128_load(raw + row * total_blocks + base));
+                }
+
+                product = wasm_v128_xor(gf256_multiply_wasm(syndrome, lo_table, hi_table),
+                                        wasm_v128_load(extra + base));
+                syndrome = wasm_v128_bitselect(product, syndrome, long_mask);
+
+                for (row = 0; row < parity; row++) {
+                    syndrome = wasm_v128_xor(gf256_multiply_wasm(syndrome, lo_table, hi_table),
+                                             wasm_v128_load(raw + ecc_offset + row * total_blocks + base));
+                }
+
+                accum = wasm_v128_or(accum, syndrome);
+            }
+
+            wasm_v128_store(result, accum);
+            for (lane = 0; lane < 16 && base + lane < total_blocks; lane++) {
+                dirty[base + lane] = result[lane];
+            }
+        }
+    }
+#else
+    {
+        const uint8_t *lo_table, *hi_table;
+        uint8_t syndrome, accum;
+
+        for (base = 0; base < total_blocks; base++) {
+            accum = 0;
+
+            for (power = 0; power < parity; power++) {
+                lo_table = syndrome_tables.mul_lo[power];
+                hi_table = syndrome_tables.mul_hi[power];
+                syndrome = 0;
+
+                for (row = 0; row < data_words; row++) {
+                    syndrome = lo_table[syndrome & RS_NIBBLE_MASK] ^ hi_table[syndrome >> RS_NIBBLE_SHIFT] ^
+                               raw[row * total_blocks + base];
+                }
+
+                if (base >= short_blocks) {
+                    syndrome =
+                        lo_table[syndrome & RS_NIBBLE_MASK] ^ hi_table[syndrome >> RS_NIBBLE_SHIFT] ^ extra[base];
+                }
+
+                for (row = 0; row < parity; row++) {
+                    syndrome = lo_table[syndrome & RS_NIBBLE_MASK] ^ hi_table[syndrome >> RS_NIBBLE_SHIFT] ^
+                               raw[ecc_offset + row * total_blocks + base];
+                }
+
+                accum |= syndrome;
+            }
+
+            dirty[base] = accum;
+        }
+    }
+#endif
+}
+
+static inline lierre_error_t correct_block_with_poporon(uint8_t *block_data, const rs_params_t *ecc_params)
+{
+    int32_t parity_bytes;
+
+    parity_bytes = ecc_params->bs - ecc_params->dw;
+    if (parity_bytes <= 0 || parity_bytes > RS_MAX_PARITY) {
+        return LIERRE_ERROR_DATA_ECC;
+    }
+
+    if (!codec_cache_decode(&rs_codecs[parity_bytes], block_data, (size_t)ecc_params->dw,
+                            &block_data[ecc_params->dw])) {
         return LIERRE_ERROR_DATA_ECC;
     }
 
@@ -327,7 +741,7 @@ static inline lierre_error_t codestream_ecc(qr_data_t *data, datastream_t *ds)
     const rs_params_t *short_block_ecc, *current_ecc;
     rs_params_t long_block_ecc;
     lierre_error_t err;
-    uint8_t *dst;
+    uint8_t *dst, dirty[RS_MAX_BLOCKS];
     int32_t long_block_count, total_blocks, ecc_offset, dst_offset, block_idx, byte_idx, parity_count;
 
     version_info = &lierre_version_db[data->version];
@@ -336,28 +750,45 @@ static inline lierre_error_t codestream_ecc(qr_data_t *data, datastream_t *ds)
         (version_info->data_bytes - short_block_ecc->bs * short_block_ecc->ns) / (short_block_ecc->bs + 1);
     total_blocks = long_block_count + short_block_ecc->ns;
     ecc_offset = short_block_ecc->dw * total_blocks + long_block_count;
+    parity_count = short_block_ecc->bs - short_block_ecc->dw;
     dst_offset = 0;
 
+    if (total_blocks > RS_MAX_BLOCKS || parity_count <= 0 || parity_count > RS_MAX_PARITY) {
+        return LIERRE_ERROR_DATA_ECC;
+    }
+
+    if (lierre_once(&codec_cache_once, codec_cache_init) != 0) {
+        return LIERRE_ERROR_DATA_ECC;
+    }
+
     lmemcpy(&long_block_ecc, short_block_ecc, sizeof(long_block_ecc));
     long_block_ecc.dw++;
     long_block_ecc.bs++;
 
+    compute_block_syndromes(ds->raw, total_blocks, short_block_ecc->ns, short_block_ecc->dw, parity_count, ecc_offset,
+                            dirty);
+
     for (block_idx = 0; block_idx < total_blocks; block_idx++) {
         dst = ds->data + dst_offset;
         current_ecc = (block_idx < short_block_ecc->ns) ? short_block_ecc : &long_block_ecc;
-        parity_count = current_ecc->bs - current_ecc->dw;
 
-        for (byte_idx = 0; byte_idx < current_ecc->dw; byte_idx++) {
+        for (byte_idx = 0; byte_idx < short_block_ecc->dw; byte_idx++) {
             dst[byte_idx] = ds->raw[byte_idx * total_blocks + block_idx];
         }
 
-        for (byte_idx = 0; byte_idx < parity_count; byte_idx++) {
-            dst[current_ecc->dw + byte_idx] = ds->raw[ecc_offset + byte_idx * total_blocks + block_idx];
+        if (current_ecc != short_block_ecc) {
+            dst[short_block_ecc->dw] = ds->raw[short_block_ecc->dw * total_blocks + block_idx - short_block_ecc->ns];
         }
 
-        err = correct_block_with_poporon(dst, current_ecc);
-        if (err) {
-            return err;
+        if (dirty[block_idx]) {
+            for (byte_idx = 0; byte_idx < parity_count; byte_idx++) {
+                dst[current_ecc->dw + byte_idx] = ds->raw[ecc_offset + byte_idx * total_blocks + block_idx];
+            }
+
+            err = correct_block_with_poporon(dst, current_ecc);
+            if (err) {
+                return err;
+            }
         }
 
         dst_offset += current_ecc->dw;
@@ -685,7 +1116,11 @@ lierre_error_t decode_qr(const qr_code_t *code, qr_data_t *data)
 
     ds.raw = data->payload;
 
-    read_data(code, data, &ds);
+    err = read_data(code, data, &ds);
+    if (err) {
+        return err;
+    }
+
     err = codestream_ecc(data, &ds);
     if (err) {
         return err;
@@ -13,10 +13,6 @@
 
 #include "../internal/decoder.h"
 
-#if LIERRE_USE_SIMD
-#include "../internal/simd.h"
-#endif
-
 #define LIERRE_HISTOGRAM_SIZE 256
 
 static inline uint8_t compute_otsu_threshold(const decoder_t *decoder)
@@ -72,180 +68,223 @@ static inline uint8_t compute_otsu_threshold(const decoder_t *decoder)
     return (uint8_t)optimal_threshold;
 }
 
-static inline void binarize_image(decoder_t *decoder, uint8_t threshold)
+static inline int32_t decoder_resize(decoder_t *decoder, int32_t width, int32_t height)
 {
-    int32_t x, y;
-    uint8_t *row, pixel_value;
-    size_t total;
-
-    total = (size_t)decoder->w * (size_t)decoder->h;
-
-#if LIERRE_USE_SIMD && defined(LIERRE_SIMD_AVX2)
-    {
-        __m256i thresh_vec, data;
-        __m256i black_lo, white_lo, result_lo;
-        __m128i data128;
-        size_t i, simd_count;
+    lierre_pixel_t *pixels;
+    uint32_t *row_runs;
+    size_t num_pixels;
 
-        simd_count = total & ~15ULL;
+    if (width < 0 || height < 0) {
+        return -1;
+    }
 
-        for (i = 0; i < simd_count; i += 16) {
-            data128 = _mm_loadu_si128((const __m128i *)(decoder->image + i));
-            data = _mm256_cvtepu8_epi16(data128);
+    num_pixels = (size_t)width * (size_t)height;
+    if (num_pixels > decoder->capacity) {
+        pixels = lmalloc(num_pixels * sizeof(lierre_pixel_t));
+        if (!pixels) {
+            return -1;
+        }
 
-            thresh_vec = _mm256_set1_epi16((int16_t)threshold);
-            black_lo = _mm256_set1_epi16((int16_t)LIERRE_PIXEL_BLACK);
-            white_lo = _mm256_set1_epi16((int16_t)LIERRE_PIXEL_WHITE);
+        if (decoder->pixels) {
+            lfree(decoder->pixels);
+        }
 
-            result_lo = _mm256_blendv_epi8(white_lo, black_lo, _mm256_cmpgt_epi16(thresh_vec, data));
+        decoder->pixels = pixels;
+        decoder->capacity = num_pixels;
+    }
 
-            _mm256_storeu_si256((__m256i *)(decoder->pixels + i), result_lo);
+    if ((size_t)height + 1 > decoder->row_runs_capacity) {
+        row_runs = lmalloc(sizeof(uint32_t) * ((size_t)height + 1));
+        if (!row_runs) {
+            return -1;
         }
 
-        for (i = simd_count; i < total; i++) {
-            decoder->pixels[i] = (decoder->image[i] < threshold) ? LIERRE_PIXEL_BLACK : LIERRE_PIXEL_WHITE;
+        if (decoder->row_runs) {
+            lfree(decoder->row_runs);
         }
+
+        decoder->row_runs = row_runs;
+        decoder->row_runs_capacity = (size_t)height + 1;
     }
-#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_NEON)
-    {
-        uint8x8_t data8, thresh_vec8;
-        uint16x8_t data16, mask16, black_vec, white_vec, result;
-        size_t i, simd_count;
 
-        black_vec = vdupq_n_u16(LIERRE_PIXEL_BLACK);
-        white_vec = vdupq_n_u16(LIERRE_PIXEL_WHITE);
+    decoder->w = width;
+    decoder->h = height;
 
-        simd_count = total & ~7ULL;
+    return 0;
+}
 
-        for (i = 0; i < simd_count; i += 8) {
-            data8 = vld1_u8(decoder->image + i);
-            data16 = vmovl_u8(data8);
-            mask16 = vcltq_u16(data16, vdupq_n_u16(threshold));
-            result = vbslq_u16(mask16, black_vec, white_vec);
-            vst1q_u16(decoder->pixels + i, result);
-        }
+static inline bool decoder_result_reserve(decoder_result_t *result, size_t count)
+{
+    decoder_code_t *codes;
 
-        for (i = simd_count; i < total; i++) {
-            decoder->pixels[i] = (decoder->image[i] < threshold) ? LIERRE_PIXEL_BLACK : LIERRE_PIXEL_WHITE;
-        }
+    codes = decoder_array_reserve(result->codes, &result->capacity, count, sizeof(decoder_code_t));
+    if (!codes) {
+        return false;
     }
-#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_WASM)
-    {
-        v128_t data8, data16_lo, data16_hi, thresh_vec, black_vec, white_vec, mask_lo, mask_hi, result_lo, result_hi;
-        size_t i, simd_count;
+    result->codes = codes;
 
-        thresh_vec = wasm_u16x8_splat(threshold);
-        black_vec = wasm_u16x8_splat(LIERRE_PIXEL_BLACK);
-        white_vec = wasm_u16x8_splat(LIERRE_PIXEL_WHITE);
+    return true;
+}
 
-        simd_count = total & ~15ULL;
+/* With lazy_refine, a grid is first sampled through its unrefined transform and refined only if that decode fails. */
+static void decode_qr_task(void *arg, uint32_t index)
+{
+    decoder_t *decoder;
+    decode_thread_ctx_t *ctx;
+    grid_t *grid;
+    uint32_t i;
 
-        for (i = 0; i < simd_count; i += 16) {
-            data8 = wasm_v128_load(decoder->image + i);
-            data16_lo = wasm_u16x8_extend_low_u8x16(data8);
-            data16_hi = wasm_u16x8_extend_high_u8x16(data8);
+    decoder = (decoder_t *)arg;
 
-            mask_lo = wasm_u16x8_lt(data16_lo, thresh_vec);
-            mask_hi = wasm_u16x8_lt(data16_hi, thresh_vec);
+    for (i = index; i < decoder->num_thread_contexts; i += decoder->num_grid_tasks) {
+        ctx = &decoder->thread_contexts[i];
 
-            result_lo = wasm_v128_bitselect(black_vec, white_vec, mask_lo);
-            result_hi = wasm_v128_bitselect(black_vec, white_vec, mask_hi);
+        if (decoder->lazy_refine) {
+            grid = &decoder->grids[ctx->grid_index];
+            grid->refine_steps = 0;
+            grid->refine_limited = false;
 
-            wasm_v128_store(decoder->pixels + i, result_lo);
-            wasm_v128_store(decoder->pixels + i + 8, result_hi);
+            extract_qr_code(ctx->decoder, ctx->grid_index, &ctx->code);
+            ctx->err = decode_qr(&ctx->code, &ctx->data);
+            if (ctx->err == LIERRE_ERROR_SUCCESS) {
+                continue;
+            }
         }
 
-        for (i = simd_count; i < total; i++) {
-            decoder->pixels[i] = (decoder->image[i] < threshold) ? LIERRE_PIXEL_BLACK : LIERRE_PIXEL_WHITE;
-        }
+        refine_qr_grid(ctx->decoder, ctx->grid_index);
+        extract_qr_code(ctx->decoder, ctx->grid_index, &ctx->code);
+        ctx->err = decode_qr(&ctx->code, &ctx->data);
     }
-#else
-    for (y = 0; y < decoder->h; y++) {
-        row = decoder->image + y * decoder->w;
-        for (x = 0; x < decoder->w; x++) {
-            pixel_value = row[x];
-            decoder->pixels[y * decoder->w + x] = (pixel_value < threshold) ? LIERRE_PIXEL_BLACK : LIERRE_PIXEL_WHITE;
-        }
-    }
-
-    (void)total;
-#endif
 }
 
-static inline int32_t decoder_resize(decoder_t *decoder, int32_t width, int32_t height)
+/*
+ * Grids are refined and decoded best-fitness first, in waves of one grid per worker. A grid is dropped before any of
+ * that work once an already decoded grid covers the same symbol.
+ */
+static inline lierre_error_t decode_grids(decoder_t *decoder, decoder_result_t *result, const executor_t *executor)
 {
-    lierre_pixel_t *pixels;
-    flood_fill_vars_t *vars;
-    uint8_t *image;
-    size_t num_vars, vars_byte_size;
+    decode_thread_ctx_t *contexts, *ctx;
+    grid_t *grid;
+    uint32_t num_slots, num_contexts, refine_remaining, i;
+    int32_t next, grid_index;
 
-    image = NULL;
-    pixels = NULL;
-    vars = NULL;
+    if (decoder->num_grids == 0) {
+        return LIERRE_ERROR_SUCCESS;
+    }
 
-    if (width < 0 || height < 0) {
-        return -1;
+    if (!order_qr_grids(decoder)) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
     }
 
-    image = lcalloc((size_t)width, (size_t)height);
-    if (!image) {
-        return -1;
+    num_slots = executor_task_count(executor, (size_t)decoder->num_grids);
+    contexts = decoder_array_reserve(decoder->thread_contexts, &decoder->thread_contexts_capacity, num_slots,
+                                     sizeof(decode_thread_ctx_t));
+    if (!contexts) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
     }
+    decoder->thread_contexts = contexts;
 
-    pixels = lcalloc((size_t)width * (size_t)height, sizeof(lierre_pixel_t));
-    if (!pixels) {
-        lfree(image);
+    refine_remaining = decoder->limits.max_refine_steps ? decoder->limits.max_refine_steps : UINT32_MAX;
 
-        return -1;
-    }
+    next = 0;
+    while (next < decoder->num_grids) {
+        num_contexts = 0;
+        while (next < decoder->num_grids && num_contexts < num_slots) {
+            grid_index = decoder->grid_order[next++];
+            if (qr_grid_is_duplicate(decoder, grid_index)) {
+                continue;
+            }
 
-    num_vars = (size_t)height * 2 / 3;
-    if (num_vars == 0) {
-        num_vars = 1;
-    }
+            grid = &decoder->grids[grid_index];
+            grid->refine_budget =
+                refine_remaining < LIERRE_DECODER_REFINE_STEPS ? refine_remaining : LIERRE_DECODER_REFINE_STEPS;
+            refine_remaining -= grid->refine_budget;
 
-    vars_byte_size = sizeof(flood_fill_vars_t) * num_vars;
-    vars = lmalloc(vars_byte_size);
-    if (!vars) {
-        lfree(image);
-        lfree(pixels);
+            ctx = &contexts[num_contexts++];
+            ctx->decoder = decoder;
+            ctx->grid_index = grid_index;
+            ctx->err = LIERRE_ERROR_INVALID_PARAMS;
+        }
 
-        return -1;
+        if (num_contexts == 0) {
+            break;
+        }
+
+        decoder->num_thread_contexts = num_contexts;
+        decoder->num_grid_tasks = executor_task_count(executor, num_contexts);
+        executor_run(executor, decode_qr_task, decoder, decoder->num_grid_tasks);
+
+        for (i = 0; i < num_contexts; i++) {
+            ctx = &contexts[i];
+            grid = &decoder->grids[ctx->grid_index];
+
+            refine_remaining += grid->refine_budget - grid->refine_steps;
+            if (grid->refine_limited) {
+                decoder->limits_hit |= LIERRE_READER_LIMIT_REFINEMENT;
+            }
+
+            /* Two workers of one wave may have decoded the same symbol; only the first is kept. */
+            if (ctx->err != LIERRE_ERROR_SUCCESS || qr_grid_is_duplicate(decoder, ctx->grid_index)) {
+                continue;
+            }
+
+            if (!decoder_result_reserve(result, result->count + 1)) {
+                return LIERRE_ERROR_DATA_OVERFLOW;
+            }
+
+            grid->decoded = true;
+            result->codes[result->count].corners[0] = ctx->code.corners[0];
+            result->codes[result->count].corners[1] = ctx->code.corners[1];
+            result->codes[result->count].corners[2] = ctx->code.corners[2];
+            result->codes[result->count].corners[3] = ctx->code.corners[3];
+            lmemcpy(result->codes[result->count].payload, ctx->data.payload, (size_t)ctx->data.payload_len);
+            result->codes[result->count].payload_len = ctx->data.payload_len;
+            result->count++;
+        }
     }
 
-    decoder->w = width;
-    decoder->h = height;
+    return LIERRE_ERROR_SUCCESS;
+}
 
-    if (decoder->image) {
-        lfree(decoder->image);
-    }
+static inline lierre_error_t decoder_process(decoder_t *decoder, const uint8_t *gray_image, int32_t width,
+                                             int32_t height, decoder_result_t *result, const executor_t *executor)
+{
+    lierre_error_t err;
+    uint8_t threshold;
 
-    decoder->image = image;
+    if (!decoder || !gray_image || !result || width <= 0 || height <= 0) {
+        return LIERRE_ERROR_INVALID_PARAMS;
+    }
 
-    if (decoder->pixels) {
-        lfree(decoder->pixels);
+    if (decoder_resize(decoder, width, height) < 0) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
     }
 
-    decoder->pixels = pixels;
+    decoder->image = gray_image;
+    decoder->num_regions = 0;
+    decoder->num_capstones = 0;
+    decoder->num_grids = 0;
+    decoder->limits_hit = LIERRE_READER_LIMIT_NONE;
+
+    threshold = compute_otsu_threshold(decoder);
+    decoder->threshold = threshold;
 
-    if (decoder->flood_fill_vars) {
-        lfree(decoder->flood_fill_vars);
+    err = detect_capstones(decoder, executor);
+    decoder->image = NULL;
+    if (err != LIERRE_ERROR_SUCCESS) {
+        return err;
     }
 
-    decoder->flood_fill_vars = vars;
-    decoder->num_flood_fill_vars = num_vars;
+    find_capstone_groups(decoder);
 
-    return 0;
-}
-
-static inline void *decode_qr_thread(void *arg)
-{
-    decode_thread_ctx_t *ctx = (decode_thread_ctx_t *)arg;
+    result->count = 0;
+    err = decode_grids(decoder, result, executor);
 
-    extract_qr_code(ctx->decoder, ctx->grid_index, &ctx->code);
-    ctx->err = decode_qr(&ctx->code, &ctx->data);
+    result->num_finder_candidates = decoder->num_finder_candidates;
+    result->num_finder_rejected = decoder->num_finder_rejected;
+    result->limits_hit = decoder->limits_hit;
 
-    return NULL;
+    return err;
 }
 
 extern decoder_t *lierre_decoder_create(void)
@@ -262,171 +301,116 @@ extern decoder_t *lierre_decoder_create(void)
 
 extern void lierre_decoder_destroy(decoder_t *decoder)
 {
+    uint32_t i;
+
     if (!decoder) {
         return;
     }
 
-    if (decoder->image) {
-        lfree(decoder->image);
-    }
-
     if (decoder->pixels) {
         lfree(decoder->pixels);
     }
 
-    if (decoder->flood_fill_vars) {
-        lfree(decoder->flood_fill_vars);
+    if (decoder->regions) {
+        lfree(decoder->regions);
     }
 
-    lfree(decoder);
-}
-
-extern lierre_error_t lierre_decoder_process(decoder_t *decoder, const uint8_t *gray_image, int32_t width,
-                                             int32_t height, decoder_result_t *result)
-{
-    qr_code_t code;
-    qr_data_t data;
-    lierre_error_t err;
-    uint8_t threshold;
-    int32_t row, i;
-
-    if (!decoder || !gray_image || !result || width <= 0 || height <= 0) {
-        return LIERRE_ERROR_INVALID_PARAMS;
+    if (decoder->capstones) {
+        lfree(decoder->capstones);
     }
 
-    if (decoder_resize(decoder, width, height) < 0) {
-        return LIERRE_ERROR_DATA_OVERFLOW;
+    if (decoder->neighbours) {
+        lfree(decoder->neighbours);
     }
 
-    lmemcpy(decoder->image, gray_image, (size_t)width * (size_t)height);
-
-    decoder->num_regions = LIERRE_PIXEL_REGION;
-    decoder->num_capstones = 0;
-    decoder->num_grids = 0;
-
-    threshold = compute_otsu_threshold(decoder);
-    decoder->threshold = threshold;
-    binarize_image(decoder, threshold);
-
-    for (row = 0; row < height; row++) {
-        scan_finder_patterns(decoder, (uint32_t)row);
+    if (decoder->capstone_index.cell_start) {
+        lfree(decoder->capstone_index.cell_start);
     }
 
-    for (i = 0; i < decoder->num_capstones; i++) {
-        find_capstone_groups(decoder, i);
+    if (decoder->capstone_index.items) {
+        lfree(decoder->capstone_index.items);
     }
 
-    result->count = 0;
-
-    for (i = 0; i < decoder->num_grids && result->count < LIERRE_DECODER_MAX_GRIDS; i++) {
-        extract_qr_code(decoder, i, &code);
-        err = decode_qr(&code, &data);
-
-        if (err == LIERRE_ERROR_SUCCESS) {
-            result->codes[result->count].corners[0] = code.corners[0];
-            result->codes[result->count].corners[1] = code.corners[1];
-            result->codes[result->count].corners[2] = code.corners[2];
-            result->codes[result->count].corners[3] = code.corners[3];
-            lmemcpy(result->codes[result->count].payload, data.payload, (size_t)data.payload_len);
-            result->codes[result->count].payload_len = data.payload_len;
-            result->count++;
-        }
+    if (decoder->capstone_index.nearby) {
+        lfree(decoder->capstone_index.nearby);
     }
 
-    return LIERRE_ERROR_SUCCESS;
-}
-
-extern lierre_error_t lierre_decoder_process_mt(decoder_t *decoder, const uint8_t *gray_image, int32_t width,
-                                                int32_t height, decoder_result_t *result, uint32_t num_threads)
-{
-    lierre_thread_t *threads;
-    decode_thread_ctx_t *contexts;
-    uint32_t active_threads, t;
-    uint8_t threshold;
-    int32_t row, i;
-
-    if (!decoder || !gray_image || !result || width <= 0 || height <= 0) {
-        return LIERRE_ERROR_INVALID_PARAMS;
+    if (decoder->grids) {
+        lfree(decoder->grids);
     }
 
-    if (num_threads < 1) {
-        num_threads = 1;
-    }
-    if (num_threads > LIERRE_DECODER_MT_MAX_THREADS) {
-        num_threads = LIERRE_DECODER_MT_MAX_THREADS;
+    if (decoder->grid_order) {
+        lfree(decoder->grid_order);
     }
 
-    if (decoder_resize(decoder, width, height) < 0) {
-        return LIERRE_ERROR_DATA_OVERFLOW;
+    for (i = 0; i <= LIERRE_DECODER_MAX_VERSION; i++) {
+        if (decoder->lattices[i].u) {
+            lfree(decoder->lattices[i].u);
+        }
     }
 
-    lmemcpy(decoder->image, gray_image, (size_t)width * (size_t)height);
-
-    decoder->num_regions = LIERRE_PIXEL_REGION;
-    decoder->num_capstones = 0;
-    decoder->num_grids = 0;
-
-    threshold = compute_otsu_threshold(decoder);
-    decoder->threshold = threshold;
-    binarize_image(decoder, threshold);
-
-    for (row = 0; row < height; row++) {
-        scan_finder_patterns(decoder, (uint32_t)row);
+    if (decoder->runs) {
+        lfree(decoder->runs);
     }
 
-    for (i = 0; i < decoder->num_capstones; i++) {
-        find_capstone_groups(decoder, i);
+    if (decoder->row_runs) {
+        lfree(decoder->row_runs);
     }
 
-    result->count = 0;
+    if (decoder->components) {
+        lfree(decoder->components);
+    }
 
-    if (decoder->num_grids == 0) {
-        return LIERRE_ERROR_SUCCESS;
+    if (decoder->stats) {
+        lfree(decoder->stats);
     }
 
-    threads = lmalloc(sizeof(lierre_thread_t) * num_threads);
-    contexts = lmalloc(sizeof(decode_thread_ctx_t) * decoder->num_grids);
-    if (!threads || !contexts) {
-        lfree(threads);
-        lfree(contexts);
-        return LIERRE_ERROR_DATA_OVERFLOW;
+    if (decoder->stripes) {
+        for (i = 0; i < decoder->stripes_capacity; i++) {
+            if (decoder->stripes[i].candidates) {
+                lfree(decoder->stripes[i].candidates);
+            }
+
+            if (decoder->stripes[i].runs) {
+                lfree(decoder->stripes[i].runs);
+            }
+        }
+        lfree(decoder->stripes);
     }
 
-    for (i = 0; i < decoder->num_grids; i++) {
-        contexts[i].decoder = decoder;
-        contexts[i].grid_index = i;
-        contexts[i].err = LIERRE_ERROR_INVALID_PARAMS;
+    if (decoder->thread_contexts) {
+        lfree(decoder->thread_contexts);
     }
 
-    i = 0;
-    while (i < decoder->num_grids) {
-        active_threads = 0;
+    lfree(decoder);
+}
 
-        for (t = 0; t < num_threads && i < decoder->num_grids; t++, i++) {
-            lierre_thread_create(&threads[t], decode_qr_thread, &contexts[i]);
-            active_threads++;
-        }
+extern decoder_result_t *lierre_decoder_result_create(void)
+{
+    return lcalloc(1, sizeof(decoder_result_t));
+}
 
-        for (t = 0; t < active_threads; t++) {
-            lierre_thread_join(threads[t], NULL);
-        }
+extern void lierre_decoder_result_destroy(decoder_result_t *result)
+{
+    if (!result) {
+        return;
     }
 
-    for (i = 0; i < decoder->num_grids && result->count < LIERRE_DECODER_MAX_GRIDS; i++) {
-        if (contexts[i].err == LIERRE_ERROR_SUCCESS) {
-            result->codes[result->count].corners[0] = contexts[i].code.corners[0];
-            result->codes[result->count].corners[1] = contexts[i].code.corners[1];
-            result->codes[result->count].corners[2] = contexts[i].code.corners[2];
-            result->codes[result->count].corners[3] = contexts[i].code.corners[3];
-            lmemcpy(result->codes[result->count].payload, contexts[i].data.payload,
-                    (size_t)contexts[i].data.payload_len);
-            result->codes[result->count].payload_len = contexts[i].data.payload_len;
-            result->count++;
-        }
+    if (result->codes) {
+        lfree(result->codes);
     }
 
-    lfree(threads);
-    lfree(contexts);
+    lfree(result);
+}
 
-    return LIERRE_ERROR_SUCCESS;
+extern lierre_error_t lierre_decoder_process(decoder_t *decoder, const uint8_t *gray_image, int32_t width,
+                                             int32_t height, decoder_result_t *result)
+{
+    return decoder_process(decoder, gray_image, width, height, result, NULL);
+}
+
+extern lierre_error_t lierre_decoder_process_mt(decoder_t *decoder, const uint8_t *gray_image, int32_t width,
+                                                int32_t height, decoder_result_t *result, const executor_t *executor)
+{
+    return decoder_process(decoder, gray_image, width, height, result, executor);
 }
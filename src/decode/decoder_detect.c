@@ -18,6 +18,7 @@
 #define FINDER_PATTERN_SCALE_FACTOR 16
 #define FINDER_TOLERANCE_DIVISOR    4
 #define FINDER_TOLERANCE_MULTIPLIER 3
+#define FINDER_CROSS_CHECK_SPAN     2
 
 #define CAPSTONE_AREA_RATIO_MIN    10
 #define CAPSTONE_AREA_RATIO_MAX    70
@@ -27,158 +28,48 @@
 #define FINDER_PATTERN_CENTER        3.5
 #define NEIGHBOR_ALIGNMENT_THRESHOLD 0.2
 
-#define NUM_CORNERS      4
-#define NUM_EDGE_SAMPLES 2
-
-static inline void flood_fill_line(decoder_t *decoder, int32_t x, int32_t y, lierre_pixel_t source_color,
-                                   lierre_pixel_t target_color, span_callback_t callback, void *user_data,
-                                   int32_t *left_out, int32_t *right_out)
-{
-    lierre_pixel_t *row;
-    int32_t left, right, i;
-
-    row = decoder->pixels + y * decoder->w;
-    left = x;
-    right = x;
-
-    while (left > 0 && row[left - 1] == source_color) {
-        left--;
-    }
+#define NEIGHBOR_RANGE_MODULES   ((double)LIERRE_DECODER_MAX_GRID_SIZE * 2.0)
+#define NEIGHBOR_SCALE_RATIO     3.0
+#define CAPSTONE_CELLS_PER_RANGE 4
 
-    while (right < decoder->w - 1 && row[right + 1] == source_color) {
-        right++;
-    }
-
-    for (i = left; i <= right; i++) {
-        row[i] = target_color;
-    }
-
-    *left_out = left;
-    *right_out = right;
-
-    if (callback) {
-        callback(user_data, y, left, right);
-    }
-}
-
-static inline flood_fill_vars_t *flood_fill_scan_next(decoder_t *decoder, lierre_pixel_t *row,
-                                                      lierre_pixel_t source_color, lierre_pixel_t target_color,
-                                                      span_callback_t callback, void *user_data,
-                                                      flood_fill_vars_t *current_state, int32_t direction)
-{
-    int32_t *scan_position, next_left;
-    flood_fill_vars_t *next_state;
-
-    scan_position = (direction < 0) ? &current_state->left_up : &current_state->left_down;
-
-    while (*scan_position <= current_state->right) {
-        if (row[*scan_position] == source_color) {
-            next_state = current_state + 1;
-            next_state->y = current_state->y + direction;
-
-            flood_fill_line(decoder, *scan_position, next_state->y, source_color, target_color, callback, user_data,
-                            &next_left, &next_state->right);
-            next_state->left_down = next_left;
-            next_state->left_up = next_left;
-
-            return next_state;
-        }
-
-        (*scan_position)++;
-    }
-
-    return NULL;
-}
+#define DETECT_STRIPE_MIN_ROWS         64
+#define FINDER_STRIPE_INITIAL_CAPACITY 32
 
-void flood_fill_seed(decoder_t *decoder, int32_t seed_x, int32_t seed_y, lierre_pixel_t source_color,
-                     lierre_pixel_t target_color, span_callback_t callback, void *user_data)
-{
-    flood_fill_vars_t *stack, *next_state, *current_state, *stack_limit;
-    lierre_pixel_t *row;
-    int32_t next_left;
-
-    if (source_color == target_color || decoder->pixels[seed_y * decoder->w + seed_x] != source_color) {
-        return;
-    }
-
-    stack = decoder->flood_fill_vars;
-    stack_limit = &stack[decoder->num_flood_fill_vars - 1];
-
-    next_state = stack;
-    next_state->y = seed_y;
-
-    flood_fill_line(decoder, seed_x, next_state->y, source_color, target_color, callback, user_data, &next_left,
-                    &next_state->right);
-    next_state->left_down = next_left;
-    next_state->left_up = next_left;
-
-    for (;;) {
-        current_state = next_state;
-
-        if (current_state == stack_limit) {
-            break;
-        }
-
-        if (current_state->y > 0) {
-            row = decoder->pixels + (current_state->y - 1) * decoder->w;
-            next_state =
-                flood_fill_scan_next(decoder, row, source_color, target_color, callback, user_data, current_state, -1);
-            if (next_state) {
-                continue;
-            }
-        }
-
-        if (current_state->y < decoder->h - 1) {
-            row = decoder->pixels + (current_state->y + 1) * decoder->w;
-            next_state =
-                flood_fill_scan_next(decoder, row, source_color, target_color, callback, user_data, current_state, 1);
-            if (next_state) {
-                continue;
-            }
-        }
-
-        if (current_state > stack) {
-            next_state = current_state - 1;
-            continue;
-        }
-
-        break;
-    }
-}
-
-static inline void region_area_callback(void *user_data, int32_t y, int32_t left, int32_t right)
-{
-    (void)y;
-
-    region_t *region;
-
-    region = (region_t *)user_data;
-    region->count += right - left + 1;
-}
+#define NUM_CORNERS      4
+#define NUM_EDGE_SAMPLES 2
 
 int32_t get_or_create_region(decoder_t *decoder, int32_t x, int32_t y)
 {
-    lierre_pixel_t pixel;
-    region_t *region_data;
-    int32_t region_id;
+    region_component_t *component;
+    region_t *regions, *region_data;
+    int32_t component_index, region_id;
 
     if (x < 0 || y < 0 || x >= decoder->w || y >= decoder->h) {
         return -1;
     }
 
-    pixel = decoder->pixels[y * decoder->w + x];
+    component_index = label_component_at(decoder, x, y);
+    if (component_index < 0) {
+        return -1;
+    }
 
-    if (pixel >= LIERRE_PIXEL_REGION) {
-        return (int32_t)pixel;
+    component = &decoder->components[component_index];
+    if (component->region >= 0) {
+        return component->region;
     }
 
-    if (pixel == LIERRE_PIXEL_WHITE) {
+    if (decoder->limits.max_region_area && (uint32_t)component->count > decoder->limits.max_region_area) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_REGION_AREA;
         return -1;
     }
 
-    if (decoder->num_regions >= LIERRE_DECODER_MAX_REGIONS) {
+    regions = decoder_array_reserve(decoder->regions, &decoder->regions_capacity, (size_t)decoder->num_regions + 1,
+                                    sizeof(region_t));
+    if (!regions) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_REGIONS;
         return -1;
     }
+    decoder->regions = regions;
 
     region_id = decoder->num_regions;
     region_data = &decoder->regions[decoder->num_regions++];
@@ -186,58 +77,49 @@ int32_t get_or_create_region(decoder_t *decoder, int32_t x, int32_t y)
     lmemset(region_data, 0, sizeof(*region_data));
     region_data->seed.x = x;
     region_data->seed.y = y;
+    region_data->count = component->count;
     region_data->capstone = -1;
-
-    flood_fill_seed(decoder, x, y, pixel, (lierre_pixel_t)region_id, region_area_callback, region_data);
+    region_data->component = (uint32_t)component_index;
+    component->region = region_id;
 
     return region_id;
 }
 
-static inline void find_farthest_corner_callback(void *user_data, int32_t y, int32_t left, int32_t right)
+static inline void find_farthest_corner_callback(void *user_data, int32_t x, int32_t y)
 {
     corner_finder_data_t *finder;
-    int32_t x_coords[2], delta_y, delta_x, distance_squared, i;
+    int32_t delta_x, delta_y, distance_squared;
 
     finder = (corner_finder_data_t *)user_data;
-    x_coords[0] = left;
-    x_coords[1] = right;
+    delta_x = x - finder->reference.x;
     delta_y = y - finder->reference.y;
+    distance_squared = delta_x * delta_x + delta_y * delta_y;
 
-    for (i = 0; i < 2; i++) {
-        delta_x = x_coords[i] - finder->reference.x;
-        distance_squared = delta_x * delta_x + delta_y * delta_y;
-
-        if (distance_squared > finder->scores[0]) {
-            finder->scores[0] = distance_squared;
-            finder->corners[0].x = x_coords[i];
-            finder->corners[0].y = y;
-        }
+    if (distance_squared > finder->scores[0]) {
+        finder->scores[0] = distance_squared;
+        finder->corners[0].x = x;
+        finder->corners[0].y = y;
     }
 }
 
-static inline void find_remaining_corners_callback(void *user_data, int32_t y, int32_t left, int32_t right)
+static inline void find_remaining_corners_callback(void *user_data, int32_t x, int32_t y)
 {
     corner_finder_data_t *finder;
-    int32_t x_coords[2], up_score, right_score, scores[4], i, j;
+    int32_t up_score, right_score, scores[4], i;
 
     finder = (corner_finder_data_t *)user_data;
-    x_coords[0] = left;
-    x_coords[1] = right;
-
-    for (i = 0; i < 2; i++) {
-        up_score = x_coords[i] * finder->reference.x + y * finder->reference.y;
-        right_score = x_coords[i] * -finder->reference.y + y * finder->reference.x;
-        scores[0] = up_score;
-        scores[1] = right_score;
-        scores[2] = -up_score;
-        scores[3] = -right_score;
-
-        for (j = 0; j < 4; j++) {
-            if (scores[j] > finder->scores[j]) {
-                finder->scores[j] = scores[j];
-                finder->corners[j].x = x_coords[i];
-                finder->corners[j].y = y;
-            }
+    up_score = x * finder->reference.x + y * finder->reference.y;
+    right_score = x * -finder->reference.y + y * finder->reference.x;
+    scores[0] = up_score;
+    scores[1] = right_score;
+    scores[2] = -up_score;
+    scores[3] = -right_score;
+
+    for (i = 0; i < 4; i++) {
+        if (scores[i] > finder->scores[i]) {
+            finder->scores[i] = scores[i];
+            finder->corners[i].x = x;
+            finder->corners[i].y = y;
         }
     }
 }
@@ -255,8 +137,7 @@ void find_region_corners(decoder_t *decoder, int32_t region_id, const decoder_po
     finder.reference = *reference;
     finder.scores[0] = -1;
 
-    flood_fill_seed(decoder, region->seed.x, region->seed.y, (lierre_pixel_t)region_id, LIERRE_PIXEL_BLACK,
-                    find_farthest_corner_callback, &finder);
+    region_for_each_extreme(decoder, region_id, find_farthest_corner_callback, &finder);
 
     finder.reference.x = finder.corners[0].x - reference->x;
     finder.reference.y = finder.corners[0].y - reference->y;
@@ -272,19 +153,23 @@ void find_region_corners(decoder_t *decoder, int32_t region_id, const decoder_po
     finder.scores[1] = i;
     finder.scores[3] = -i;
 
-    flood_fill_seed(decoder, region->seed.x, region->seed.y, LIERRE_PIXEL_BLACK, (lierre_pixel_t)region_id,
-                    find_remaining_corners_callback, &finder);
+    region_for_each_extreme(decoder, region_id, find_remaining_corners_callback, &finder);
 }
 
 static inline void record_capstone(decoder_t *decoder, int32_t ring_region_id, int32_t stone_region_id)
 {
     region_t *stone_region, *ring_region;
-    capstone_t *capstone;
-    int32_t capstone_index;
-
-    if (decoder->num_capstones >= LIERRE_DECODER_MAX_CAPSTONES) {
+    capstone_t *capstones, *capstone;
+    int32_t capstone_index, i;
+    double perimeter, dx, dy;
+
+    capstones = decoder_array_reserve(decoder->capstones, &decoder->capstones_capacity,
+                                      (size_t)decoder->num_capstones + 1, sizeof(capstone_t));
+    if (!capstones) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_CAPSTONES;
         return;
     }
+    decoder->capstones = capstones;
 
     stone_region = &decoder->regions[stone_region_id];
     ring_region = &decoder->regions[ring_region_id];
@@ -294,6 +179,7 @@ static inline void record_capstone(decoder_t *decoder, int32_t ring_region_id, i
 
     lmemset(capstone, 0, sizeof(*capstone));
     capstone->qr_grid = -1;
+    perimeter = 0.0;
     capstone->ring = ring_region_id;
     capstone->stone = stone_region_id;
     stone_region->capstone = capstone_index;
@@ -302,6 +188,13 @@ static inline void record_capstone(decoder_t *decoder, int32_t ring_region_id, i
     find_region_corners(decoder, ring_region_id, &stone_region->seed, capstone->corners);
     perspective_setup(capstone->c, capstone->corners, FINDER_PATTERN_SIZE, FINDER_PATTERN_SIZE);
     perspective_map(capstone->c, FINDER_PATTERN_CENTER, FINDER_PATTERN_CENTER, &capstone->center);
+
+    for (i = 0; i < NUM_CORNERS; i++) {
+        dx = (double)(capstone->corners[(i + 1) % NUM_CORNERS].x - capstone->corners[i].x);
+        dy = (double)(capstone->corners[(i + 1) % NUM_CORNERS].y - capstone->corners[i].y);
+        perimeter += sqrt(dx * dx + dy * dy);
+    }
+    capstone->module_size = perimeter / (NUM_CORNERS * FINDER_PATTERN_SIZE);
 }
 
 static inline void test_capstone(decoder_t *decoder, uint32_t x, uint32_t y, uint32_t *pattern_widths)
@@ -345,74 +238,395 @@ static inline void test_capstone(decoder_t *decoder, uint32_t x, uint32_t y, uin
     record_capstone(decoder, ring_left_region, stone_region);
 }
 
-void scan_finder_patterns(decoder_t *decoder, uint32_t y)
+static inline bool finder_stripe_push(decoder_stripe_t *stripe, uint32_t x, uint32_t y, const uint32_t *pattern_widths)
+{
+    finder_candidate_t *candidates, *candidate;
+    size_t capacity;
+
+    if (stripe->num_candidates >= stripe->capacity) {
+        capacity = stripe->capacity ? stripe->capacity * 2 : FINDER_STRIPE_INITIAL_CAPACITY;
+        candidates = lmalloc(sizeof(finder_candidate_t) * capacity);
+        if (!candidates) {
+            return false;
+        }
+
+        if (stripe->candidates) {
+            lmemcpy(candidates, stripe->candidates, sizeof(finder_candidate_t) * stripe->num_candidates);
+            lfree(stripe->candidates);
+        }
+
+        stripe->candidates = candidates;
+        stripe->capacity = capacity;
+    }
+
+    candidate = &stripe->candidates[stripe->num_candidates++];
+    candidate->x = x;
+    candidate->y = y;
+    lmemcpy(candidate->pattern_widths, pattern_widths, sizeof(candidate->pattern_widths));
+
+    return true;
+}
+
+static inline bool finder_pattern_matches(const uint32_t *pattern_widths)
+{
+    uint32_t average_width, tolerance;
+    int32_t scale_factor;
+
+    scale_factor = FINDER_PATTERN_SCALE_FACTOR;
+    average_width = (pattern_widths[0] + pattern_widths[1] + pattern_widths[3] + pattern_widths[4]) * scale_factor /
+                    FINDER_TOLERANCE_DIVISOR;
+    tolerance = average_width * FINDER_TOLERANCE_MULTIPLIER / FINDER_TOLERANCE_DIVISOR;
+
+    if ((pattern_widths[0] * scale_factor < average_width - tolerance ||
+         pattern_widths[0] * scale_factor > average_width + tolerance) ||
+        (pattern_widths[1] * scale_factor < average_width - tolerance ||
+         pattern_widths[1] * scale_factor > average_width + tolerance) ||
+        (pattern_widths[2] * scale_factor < FINDER_PATTERN_CENTER_RATIO * average_width - tolerance ||
+         pattern_widths[2] * scale_factor > FINDER_PATTERN_CENTER_RATIO * average_width + tolerance) ||
+        (pattern_widths[3] * scale_factor < average_width - tolerance ||
+         pattern_widths[3] * scale_factor > average_width + tolerance) ||
+        (pattern_widths[4] * scale_factor < average_width - tolerance ||
+         pattern_widths[4] * scale_factor > average_width + tolerance)) {
+        return false;
+    }
+
+    return true;
+}
+
+static inline uint32_t cross_check_walk(const decoder_t *decoder, int32_t x, int32_t *y, int32_t step, bool black,
+                                        uint32_t limit)
+{
+    uint32_t count;
+
+    count = 0;
+    while (*y >= 0 && *y < decoder->h && count <= limit &&
+           (decoder->image[(size_t)*y * (size_t)decoder->w + (size_t)x] < decoder->threshold) == black) {
+        count++;
+        *y += step;
+    }
+
+    return count;
+}
+
+static inline bool finder_cross_check(const decoder_t *decoder, int32_t x, int32_t y, const uint32_t *pattern_widths)
+{
+    uint32_t vertical_widths[FINDER_PATTERN_MODULES], limit;
+    int32_t up, down;
+
+    /* A run longer than this cannot belong to the same pattern seen from any sane viewing angle. */
+    limit = (pattern_widths[0] + pattern_widths[1] + pattern_widths[2] + pattern_widths[3] + pattern_widths[4]) *
+            FINDER_CROSS_CHECK_SPAN;
+
+    up = y - 1;
+    down = y;
+    vertical_widths[2] = cross_check_walk(decoder, x, &down, 1, true, limit);
+    vertical_widths[2] += cross_check_walk(decoder, x, &up, -1, true, limit);
+    vertical_widths[1] = cross_check_walk(decoder, x, &up, -1, false, limit);
+    vertical_widths[0] = cross_check_walk(decoder, x, &up, -1, true, limit);
+    vertical_widths[3] = cross_check_walk(decoder, x, &down, 1, false, limit);
+    vertical_widths[4] = cross_check_walk(decoder, x, &down, 1, true, limit);
+
+    if (!vertical_widths[0] || !vertical_widths[1] || !vertical_widths[3] || !vertical_widths[4] ||
+        vertical_widths[0] > limit || vertical_widths[2] > limit || vertical_widths[4] > limit) {
+        return false;
+    }
+
+    return finder_pattern_matches(vertical_widths);
+}
+
+static inline bool scan_finder_row(decoder_t *decoder, decoder_stripe_t *stripe, uint32_t y)
+{
+    const pixel_run_t *runs;
+    uint32_t pattern_widths[FINDER_PATTERN_MODULES], first, last, i;
+
+    runs = stripe->runs;
+    first = decoder->row_runs[y];
+    last = (uint32_t)stripe->num_runs;
+
+    /*
+     * A pattern is black, white, black, white, black ending where the row turns white again. The gaps between
+     * consecutive black runs are the white widths, and a run touching the right border never closes.
+     */
+    for (i = first + 2; i < last && runs[i].right < decoder->w - 1; i++) {
+        pattern_widths[0] = (uint32_t)(runs[i - 2].right - runs[i - 2].left + 1);
+        pattern_widths[1] = (uint32_t)(runs[i - 1].left - runs[i - 2].right - 1);
+        pattern_widths[2] = (uint32_t)(runs[i - 1].right - runs[i - 1].left + 1);
+        pattern_widths[3] = (uint32_t)(runs[i].left - runs[i - 1].right - 1);
+        pattern_widths[4] = (uint32_t)(runs[i].right - runs[i].left + 1);
+
+        if (!finder_pattern_matches(pattern_widths)) {
+            continue;
+        }
+
+        /* Most horizontal hits on text are rejected here, before they take up a region slot. */
+        if (!finder_cross_check(decoder, (runs[i - 1].left + runs[i - 1].right) / 2, (int32_t)y, pattern_widths)) {
+            stripe->num_rejected++;
+            continue;
+        }
+
+        if (!finder_stripe_push(stripe, (uint32_t)runs[i].right + 1, y, pattern_widths)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void detect_stripe_task(void *arg, uint32_t index)
+{
+    decoder_t *decoder;
+    decoder_stripe_t *stripe;
+    uint32_t y;
+
+    decoder = (decoder_t *)arg;
+    stripe = &decoder->stripes[index];
+
+    stripe->num_candidates = 0;
+    stripe->num_runs = 0;
+    stripe->num_rejected = 0;
+    stripe->failed = false;
+
+    for (y = stripe->row_begin; y < stripe->row_end; y++) {
+        if (!label_binarize_row(decoder, stripe, y) || !scan_finder_row(decoder, stripe, y)) {
+            stripe->failed = true;
+            return;
+        }
+    }
+}
+
+static inline bool detect_stripes_reserve(decoder_t *decoder, uint32_t num_stripes)
+{
+    decoder_stripe_t *stripes;
+
+    if (num_stripes <= decoder->stripes_capacity) {
+        return true;
+    }
+
+    stripes = lcalloc(num_stripes, sizeof(decoder_stripe_t));
+    if (!stripes) {
+        return false;
+    }
+
+    if (decoder->stripes) {
+        lmemcpy(stripes, decoder->stripes, sizeof(decoder_stripe_t) * decoder->stripes_capacity);
+        lfree(decoder->stripes);
+    }
+
+    decoder->stripes = stripes;
+    decoder->stripes_capacity = num_stripes;
+
+    return true;
+}
+
+lierre_error_t detect_capstones(decoder_t *decoder, const executor_t *executor)
+{
+    decoder_stripe_t *stripe;
+    finder_candidate_t *candidate;
+    lierre_error_t err;
+    uint32_t num_stripes, rows_per_stripe, height, num_tested, i;
+    size_t j;
+
+    height = (uint32_t)decoder->h;
+    num_stripes = executor_task_count(executor, height / DETECT_STRIPE_MIN_ROWS);
+
+    if (!detect_stripes_reserve(decoder, num_stripes)) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
+    }
+
+    rows_per_stripe = (height + num_stripes - 1) / num_stripes;
+    for (i = 0; i < num_stripes; i++) {
+        stripe = &decoder->stripes[i];
+        stripe->row_begin = i * rows_per_stripe < height ? i * rows_per_stripe : height;
+        stripe->row_end = stripe->row_begin + rows_per_stripe < height ? stripe->row_begin + rows_per_stripe : height;
+    }
+    decoder->num_stripes = num_stripes;
+
+    executor_run(executor, detect_stripe_task, decoder, num_stripes);
+
+    err = label_merge_stripes(decoder, executor);
+    if (err != LIERRE_ERROR_SUCCESS) {
+        return err;
+    }
+
+    decoder->num_finder_candidates = 0;
+    decoder->num_finder_rejected = 0;
+    num_tested = 0;
+
+    /* Candidates are tested in row order so region ids are assigned exactly as a serial scan would. */
+    for (i = 0; i < num_stripes; i++) {
+        stripe = &decoder->stripes[i];
+        decoder->num_finder_candidates += (uint32_t)stripe->num_candidates + stripe->num_rejected;
+        decoder->num_finder_rejected += stripe->num_rejected;
+
+        for (j = 0; j < stripe->num_candidates; j++) {
+            if (decoder->limits.max_candidates && num_tested >= decoder->limits.max_candidates) {
+                decoder->limits_hit |= LIERRE_READER_LIMIT_CANDIDATES;
+                break;
+            }
+
+            candidate = &stripe->candidates[j];
+            test_capstone(decoder, candidate->x, candidate->y, candidate->pattern_widths);
+            num_tested++;
+        }
+    }
+
+    return LIERRE_ERROR_SUCCESS;
+}
+
+static inline int32_t capstone_cell(double position, double cell_size, int32_t num_cells)
+{
+    int32_t cell;
+
+    cell = (int32_t)(position / cell_size);
+    if (cell < 0) {
+        return 0;
+    }
+
+    return cell < num_cells ? cell : num_cells - 1;
+}
+
+static inline double capstone_range(const capstone_t *capstone)
 {
-    lierre_pixel_t *row, current_color;
-    uint32_t x, previous_color, run_length, run_count, pattern_widths[5] = {0}, average_width, tolerance, i;
-    int32_t is_valid, scale_factor;
-
-    row = decoder->pixels + y * decoder->w;
-    previous_color = 0;
-    run_length = 0;
-    run_count = 0;
-
-    for (x = 0; x < (uint32_t)decoder->w; x++) {
-        current_color = row[x] ? 1 : 0;
-
-        if (x && current_color != previous_color) {
-            lmemmove(pattern_widths, pattern_widths + 1, sizeof(pattern_widths[0]) * (FINDER_PATTERN_MODULES - 1));
-            pattern_widths[FINDER_PATTERN_MODULES - 1] = run_length;
-            run_length = 0;
-            run_count++;
-
-            if (!current_color && run_count >= FINDER_PATTERN_MODULES) {
-                scale_factor = FINDER_PATTERN_SCALE_FACTOR;
-                average_width = (pattern_widths[0] + pattern_widths[1] + pattern_widths[3] + pattern_widths[4]) *
-                                scale_factor / FINDER_TOLERANCE_DIVISOR;
-                tolerance = average_width * FINDER_TOLERANCE_MULTIPLIER / FINDER_TOLERANCE_DIVISOR;
-                is_valid = 1;
-
-                if ((pattern_widths[0] * scale_factor < average_width - tolerance ||
-                     pattern_widths[0] * scale_factor > average_width + tolerance) ||
-                    (pattern_widths[1] * scale_factor < average_width - tolerance ||
-                     pattern_widths[1] * scale_factor > average_width + tolerance) ||
-                    (pattern_widths[2] * scale_factor < FINDER_PATTERN_CENTER_RATIO * average_width - tolerance ||
-                     pattern_widths[2] * scale_factor > FINDER_PATTERN_CENTER_RATIO * average_width + tolerance) ||
-                    (pattern_widths[3] * scale_factor < average_width - tolerance ||
-                     pattern_widths[3] * scale_factor > average_width + tolerance) ||
-                    (pattern_widths[4] * scale_factor < average_width - tolerance ||
-                     pattern_widths[4] * scale_factor > average_width + tolerance)) {
-                    is_valid = 0;
+    return capstone->module_size * NEIGHBOR_RANGE_MODULES;
+}
+
+/* Buckets capstone centres into square cells, each bucket listing its capstones in ascending index order. */
+static inline bool capstone_index_build(decoder_t *decoder)
+{
+    capstone_index_t *index;
+    capstone_t *capstone;
+    uint32_t *cell_start;
+    int32_t *items, *nearby, i, cell;
+    size_t num_cells;
+    double max_range;
+
+    index = &decoder->capstone_index;
+
+    max_range = 0.0;
+    for (i = 0; i < decoder->num_capstones; i++) {
+        if (capstone_range(&decoder->capstones[i]) > max_range) {
+            max_range = capstone_range(&decoder->capstones[i]);
+        }
+    }
+
+    index->cell_size = max_range / CAPSTONE_CELLS_PER_RANGE;
+    if (index->cell_size < 1.0) {
+        index->cell_size = 1.0;
+    }
+    index->cols = (int32_t)(decoder->w / index->cell_size) + 1;
+    index->rows = (int32_t)(decoder->h / index->cell_size) + 1;
+    num_cells = (size_t)index->cols * (size_t)index->rows;
+
+    cell_start = decoder_array_reserve(index->cell_start, &index->cell_capacity, num_cells + 1, sizeof(uint32_t));
+    if (!cell_start) {
+        return false;
+    }
+    index->cell_start = cell_start;
+
+    items = decoder_array_reserve(index->items, &index->items_capacity, (size_t)decoder->num_capstones,
+                                  sizeof(int32_t));
+    if (!items) {
+        return false;
+    }
+    index->items = items;
+
+    nearby = decoder_array_reserve(index->nearby, &index->nearby_capacity, (size_t)decoder->num_capstones,
+                                   sizeof(int32_t));
+    if (!nearby) {
+        return false;
+    }
+    index->nearby = nearby;
+
+    lmemset(cell_start, 0, sizeof(uint32_t) * (num_cells + 1));
+    for (i = 0; i < decoder->num_capstones; i++) {
+        capstone = &decoder->capstones[i];
+        cell = capstone_cell(capstone->center.y, index->cell_size, index->rows) * index->cols +
+               capstone_cell(capstone->center.x, index->cell_size, index->cols);
+        cell_start[cell]++;
+    }
+
+    for (i = 1; i <= (int32_t)num_cells; i++) {
+        cell_start[i] += cell_start[i - 1];
+    }
+
+    /* Filling backwards from each cell's end leaves cell_start[c] at the cell's first item. */
+    for (i = decoder->num_capstones - 1; i >= 0; i--) {
+        capstone = &decoder->capstones[i];
+        cell = capstone_cell(capstone->center.y, index->cell_size, index->rows) * index->cols +
+               capstone_cell(capstone->center.x, index->cell_size, index->cols);
+        items[--cell_start[cell]] = i;
+    }
+
+    return true;
+}
+
+/* Collects, in ascending index order, the capstones close and similar enough in scale to pair with capstone_index. */
+static inline int32_t capstone_index_query(const decoder_t *decoder, int32_t capstone_index)
+{
+    const capstone_index_t *index;
+    const capstone_t *current_capstone, *other_capstone;
+    int32_t *nearby, count, x0, x1, y0, y1, cx, cy, j, other;
+    uint32_t item;
+    double range, dx, dy, scale;
+
+    index = &decoder->capstone_index;
+    nearby = index->nearby;
+    current_capstone = &decoder->capstones[capstone_index];
+    range = capstone_range(current_capstone);
+
+    x0 = capstone_cell(current_capstone->center.x - range, index->cell_size, index->cols);
+    x1 = capstone_cell(current_capstone->center.x + range, index->cell_size, index->cols);
+    y0 = capstone_cell(current_capstone->center.y - range, index->cell_size, index->rows);
+    y1 = capstone_cell(current_capstone->center.y + range, index->cell_size, index->rows);
+
+    count = 0;
+    for (cy = y0; cy <= y1; cy++) {
+        for (cx = x0; cx <= x1; cx++) {
+            for (item = index->cell_start[cy * index->cols + cx]; item < index->cell_start[cy * index->cols + cx + 1];
+                 item++) {
+                other = index->items[item];
+                if (other == capstone_index) {
+                    continue;
+                }
+
+                other_capstone = &decoder->capstones[other];
+                dx = (double)(other_capstone->center.x - current_capstone->center.x);
+                dy = (double)(other_capstone->center.y - current_capstone->center.y);
+                scale = other_capstone->module_size / current_capstone->module_size;
+                if (dx * dx + dy * dy > range * range || scale > NEIGHBOR_SCALE_RATIO ||
+                    scale * NEIGHBOR_SCALE_RATIO < 1.0) {
+                    continue;
                 }
 
-                if (is_valid) {
-                    test_capstone(decoder, x, y, pattern_widths);
+                for (j = count; j > 0 && nearby[j - 1] > other; j--) {
+                    nearby[j] = nearby[j - 1];
                 }
+                nearby[j] = other;
+                count++;
             }
         }
-
-        run_length++;
-        previous_color = current_color;
     }
+
+    return count;
 }
 
-void find_capstone_groups(decoder_t *decoder, int32_t capstone_index)
+static inline void group_capstone(decoder_t *decoder, int32_t capstone_index)
 {
     capstone_t *current_capstone, *other_capstone;
     capstone_neighbour_list_t horizontal_list, vertical_list;
     capstone_neighbour_t *neighbour;
-    int32_t j;
+    int32_t num_nearby, j, k;
     double grid_u, grid_v;
 
     current_capstone = &decoder->capstones[capstone_index];
+    horizontal_list.entries = decoder->neighbours;
     horizontal_list.count = 0;
+    vertical_list.entries = decoder->neighbours + decoder->num_capstones;
     vertical_list.count = 0;
 
-    for (j = 0; j < decoder->num_capstones; j++) {
-        if (capstone_index == j) {
-            continue;
-        }
-
+    num_nearby = capstone_index_query(decoder, capstone_index);
+    for (k = 0; k < num_nearby; k++) {
+        j = decoder->capstone_index.nearby[k];
         other_capstone = &decoder->capstones[j];
         perspective_unmap(current_capstone->c, &other_capstone->center, &grid_u, &grid_v);
 
@@ -436,3 +650,30 @@ void find_capstone_groups(decoder_t *decoder, int32_t capstone_index)
         test_neighbour_pairs(decoder, capstone_index, &horizontal_list, &vertical_list);
     }
 }
+
+void find_capstone_groups(decoder_t *decoder)
+{
+    capstone_neighbour_t *neighbours;
+    int32_t i;
+
+    if (decoder->num_capstones < 3) {
+        return;
+    }
+
+    neighbours = decoder_array_reserve(decoder->neighbours, &decoder->neighbours_capacity,
+                                       (size_t)decoder->num_capstones * 2, sizeof(capstone_neighbour_t));
+    if (!neighbours) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_CAPSTONES;
+        return;
+    }
+    decoder->neighbours = neighbours;
+
+    if (!capstone_index_build(decoder)) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_CAPSTONES;
+        return;
+    }
+
+    for (i = 0; i < decoder->num_capstones; i++) {
+        group_capstone(decoder, i);
+    }
+}
@@ -12,6 +12,7 @@
  */
 
 #include "../internal/decoder.h"
+#include "../internal/simd.h"
 
 #define QR_VERSION_MIN               1
 #define QR_VERSION1_SIZE             17
@@ -28,14 +29,15 @@
 
 #define PERSPECTIVE_ADJUSTMENT_FACTOR 0.02
 #define PERSPECTIVE_STEP_DECAY        0.5
-#define PERSPECTIVE_REFINEMENT_PASSES 5
 #define PERSPECTIVE_PARAM_ITERATIONS  16
+#define PERSPECTIVE_REFINEMENT_PASSES (LIERRE_DECODER_REFINE_STEPS / PERSPECTIVE_PARAM_ITERATIONS)
 
 #define CELL_SAMPLE_COUNT    3
 #define CELL_SAMPLE_OFFSET_1 0.3
 #define CELL_SAMPLE_OFFSET_2 0.5
 #define CELL_SAMPLE_OFFSET_3 0.7
 #define CELL_CENTER_OFFSET   0.5
+#define CELL_LATTICE_BATCH   4
 
 #define ROUNDING_OFFSET 0.5
 #define AVERAGE_FACTOR  0.5
@@ -231,115 +233,91 @@ static inline void estimate_grid_size(decoder_t *decoder, int32_t grid_index)
     grid->grid_size = QR_VERSION_SIZE_INCREMENT * version + QR_VERSION1_SIZE;
 }
 
-static inline int32_t read_grid_cell(const decoder_t *decoder, int32_t grid_index, int32_t x, int32_t y)
+static inline int32_t sample_grid_pixel(const decoder_t *decoder, const decoder_point_t *image_point)
 {
-    const grid_t *grid;
-    decoder_point_t image_point;
-
-    grid = &decoder->grids[grid_index];
-    perspective_map(grid->c, (double)x + CELL_CENTER_OFFSET, (double)y + CELL_CENTER_OFFSET, &image_point);
-
-    if (image_point.y < 0 || image_point.y >= decoder->h || image_point.x < 0 || image_point.x >= decoder->w) {
+    if (image_point->y < 0 || image_point->y >= decoder->h || image_point->x < 0 || image_point->x >= decoder->w) {
         return 0;
     }
 
-    return decoder->pixels[image_point.y * decoder->w + image_point.x] ? 1 : -1;
+    return decoder->pixels[image_point->y * decoder->w + image_point->x] ? 1 : -1;
 }
 
-static inline int32_t compute_cell_fitness(const decoder_t *decoder, int32_t grid_index, int32_t x, int32_t y)
+static inline void lattice_add_cell(int32_t *weights, int32_t size, int32_t x, int32_t y, int32_t weight)
 {
-    static const double sample_offsets[CELL_SAMPLE_COUNT] = {CELL_SAMPLE_OFFSET_1, CELL_SAMPLE_OFFSET_2,
-                                                             CELL_SAMPLE_OFFSET_3};
-    const grid_t *grid;
-    decoder_point_t image_point;
-    int32_t score, sample_x, sample_y;
-
-    grid = &decoder->grids[grid_index];
-    score = 0;
-
-    for (sample_y = 0; sample_y < CELL_SAMPLE_COUNT; sample_y++) {
-        for (sample_x = 0; sample_x < CELL_SAMPLE_COUNT; sample_x++) {
-            perspective_map(grid->c, (double)x + sample_offsets[sample_x], (double)y + sample_offsets[sample_y],
-                            &image_point);
-
-            if (image_point.y < 0 || image_point.y >= decoder->h || image_point.x < 0 || image_point.x >= decoder->w) {
-                continue;
-            }
-
-            if (decoder->pixels[image_point.y * decoder->w + image_point.x]) {
-                score++;
-            } else {
-                score--;
-            }
-        }
+    if (x < 0 || x >= size || y < 0 || y >= size) {
+        return;
     }
 
-    return score;
+    weights[y * size + x] += weight;
 }
 
-static inline int32_t compute_ring_fitness(const decoder_t *decoder, int32_t grid_index, int32_t center_x,
-                                           int32_t center_y, int32_t radius)
+static inline void lattice_add_ring(int32_t *weights, int32_t size, int32_t center_x, int32_t center_y,
+                                    int32_t radius, int32_t weight)
 {
-    int32_t i, score;
-
-    score = 0;
+    int32_t i;
 
     for (i = 0; i < radius * 2; i++) {
-        score += compute_cell_fitness(decoder, grid_index, center_x - radius + i, center_y - radius);
-        score += compute_cell_fitness(decoder, grid_index, center_x - radius, center_y + radius - i);
-        score += compute_cell_fitness(decoder, grid_index, center_x + radius, center_y - radius + i);
-        score += compute_cell_fitness(decoder, grid_index, center_x + radius - i, center_y + radius);
+        lattice_add_cell(weights, size, center_x - radius + i, center_y - radius, weight);
+        lattice_add_cell(weights, size, center_x - radius, center_y + radius - i, weight);
+        lattice_add_cell(weights, size, center_x + radius, center_y - radius + i, weight);
+        lattice_add_cell(weights, size, center_x + radius - i, center_y + radius, weight);
     }
-
-    return score;
 }
 
-static inline int32_t compute_alignment_pattern_fitness(const decoder_t *decoder, int32_t grid_index, int32_t center_x,
-                                                        int32_t center_y)
+static inline void lattice_add_alignment_pattern(int32_t *weights, int32_t size, int32_t center_x, int32_t center_y)
 {
-    return compute_cell_fitness(decoder, grid_index, center_x, center_y) -
-           compute_ring_fitness(decoder, grid_index, center_x, center_y, ALIGNMENT_RING_RADIUS_1) +
-           compute_ring_fitness(decoder, grid_index, center_x, center_y, ALIGNMENT_RING_RADIUS_2);
+    lattice_add_cell(weights, size, center_x, center_y, 1);
+    lattice_add_ring(weights, size, center_x, center_y, ALIGNMENT_RING_RADIUS_1, -1);
+    lattice_add_ring(weights, size, center_x, center_y, ALIGNMENT_RING_RADIUS_2, 1);
 }
 
-static inline int32_t compute_capstone_fitness(const decoder_t *decoder, int32_t grid_index, int32_t x, int32_t y)
+static inline void lattice_add_capstone(int32_t *weights, int32_t size, int32_t x, int32_t y)
 {
     x += FINDER_PATTERN_CENTER;
     y += FINDER_PATTERN_CENTER;
 
-    return compute_cell_fitness(decoder, grid_index, x, y) +
-           compute_ring_fitness(decoder, grid_index, x, y, ALIGNMENT_RING_RADIUS_1) -
-           compute_ring_fitness(decoder, grid_index, x, y, ALIGNMENT_RING_RADIUS_2) +
-           compute_ring_fitness(decoder, grid_index, x, y, ALIGNMENT_RING_RADIUS_3);
+    lattice_add_cell(weights, size, x, y, 1);
+    lattice_add_ring(weights, size, x, y, ALIGNMENT_RING_RADIUS_1, 1);
+    lattice_add_ring(weights, size, x, y, ALIGNMENT_RING_RADIUS_2, -1);
+    lattice_add_ring(weights, size, x, y, ALIGNMENT_RING_RADIUS_3, 1);
 }
 
-static inline int32_t compute_total_grid_fitness(const decoder_t *decoder, int32_t grid_index)
+/*
+ * The fitness of a grid is a signed sum over timing, finder and alignment cells, each sampled on a 3x3 sub-lattice.
+ * Which cells count and with what sign depends on the version only, so the weights are merged per cell once and the
+ * sample coordinates of every cell with a nonzero weight are kept, padded to a whole batch with zero weights.
+ */
+static inline bool build_grid_lattice(decoder_t *decoder, int32_t version)
 {
-    const grid_t *grid;
+    static const double sample_offsets[CELL_SAMPLE_COUNT] = {CELL_SAMPLE_OFFSET_1, CELL_SAMPLE_OFFSET_2,
+                                                             CELL_SAMPLE_OFFSET_3};
     const version_info_t *version_info;
-    int32_t version, score, i, j, alignment_count, expected_value;
-
-    grid = &decoder->grids[grid_index];
-    version = (grid->grid_size - QR_VERSION1_SIZE) / QR_VERSION_SIZE_INCREMENT;
-
-    if (version < QR_VERSION_MIN || version > LIERRE_DECODER_MAX_VERSION) {
-        return 0;
+    grid_lattice_t *lattice;
+    double *samples;
+    int32_t *weights, size, alignment_count, i, j, x, y, sample_x, sample_y;
+    size_t num_cells, count, index;
+
+    lattice = &decoder->lattices[version];
+    if (lattice->u) {
+        return true;
     }
 
     version_info = &lierre_version_db[version];
-    score = 0;
+    size = QR_VERSION_SIZE_INCREMENT * version + QR_VERSION1_SIZE;
+
+    weights = lcalloc((size_t)size * (size_t)size, sizeof(int32_t));
+    if (!weights) {
+        return false;
+    }
 
-    for (i = 0; i < grid->grid_size - TIMING_PATTERN_MARGIN; i++) {
-        expected_value = (i & 1) ? 1 : -1;
-        score += compute_cell_fitness(decoder, grid_index, i + TIMING_PATTERN_OFFSET, TIMING_PATTERN_POSITION) *
-                 expected_value;
-        score += compute_cell_fitness(decoder, grid_index, TIMING_PATTERN_POSITION, i + TIMING_PATTERN_OFFSET) *
-                 expected_value;
+    for (i = 0; i < size - TIMING_PATTERN_MARGIN; i++) {
+        lattice_add_cell(weights, size, i + TIMING_PATTERN_OFFSET, TIMING_PATTERN_POSITION, (i & 1) ? 1 : -1);
+        lattice_add_cell(weights, size, TIMING_PATTERN_POSITION, i + TIMING_PATTERN_OFFSET, (i & 1) ? 1 : -1);
     }
 
-    score += compute_capstone_fitness(decoder, grid_index, 0, 0);
-    score += compute_capstone_fitness(decoder, grid_index, grid->grid_size - FINDER_PATTERN_SIZE, 0);
-    score += compute_capstone_fitness(decoder, grid_index, 0, grid->grid_size - FINDER_PATTERN_SIZE);
+    lattice_add_capstone(weights, size, 0, 0);
+    lattice_add_capstone(weights, size, size - FINDER_PATTERN_SIZE, 0);
+    lattice_add_capstone(weights, size, 0, size - FINDER_PATTERN_SIZE);
 
     alignment_count = 0;
     while (alignment_count < LIERRE_DECODER_MAX_ALIGNMENT && version_info->apat[alignment_count]) {
@@ -347,28 +325,203 @@ static inline int32_t compute_total_grid_fitness(const decoder_t *decoder, int32
     }
 
     for (i = 1; i + 1 < alignment_count; i++) {
-        score += compute_alignment_pattern_fitness(decoder, grid_index, TIMING_PATTERN_POSITION, version_info->apat[i]);
-        score += compute_alignment_pattern_fitness(decoder, grid_index, version_info->apat[i], TIMING_PATTERN_POSITION);
+        lattice_add_alignment_pattern(weights, size, TIMING_PATTERN_POSITION, version_info->apat[i]);
+        lattice_add_alignment_pattern(weights, size, version_info->apat[i], TIMING_PATTERN_POSITION);
     }
 
     for (i = 1; i < alignment_count; i++) {
         for (j = 1; j < alignment_count; j++) {
-            score +=
-                compute_alignment_pattern_fitness(decoder, grid_index, version_info->apat[i], version_info->apat[j]);
+            lattice_add_alignment_pattern(weights, size, version_info->apat[i], version_info->apat[j]);
+        }
+    }
+
+    num_cells = 0;
+    for (i = 0; i < size * size; i++) {
+        if (weights[i]) {
+            num_cells++;
+        }
+    }
+
+    count = num_cells * CELL_SAMPLE_COUNT * CELL_SAMPLE_COUNT;
+    count = (count + CELL_LATTICE_BATCH - 1) / CELL_LATTICE_BATCH * CELL_LATTICE_BATCH;
+
+    /* u, v and weights share one allocation, owned through u. */
+    samples = lmalloc(count * (sizeof(double) * 2 + sizeof(int32_t)));
+    if (!samples) {
+        lfree(weights);
+        return false;
+    }
+
+    lattice->u = samples;
+    lattice->v = samples + count;
+    lattice->weights = (int32_t *)(samples + count * 2);
+    lattice->count = count;
+
+    index = 0;
+    for (y = 0; y < size; y++) {
+        for (x = 0; x < size; x++) {
+            if (!weights[y * size + x]) {
+                continue;
+            }
+
+            for (sample_y = 0; sample_y < CELL_SAMPLE_COUNT; sample_y++) {
+                for (sample_x = 0; sample_x < CELL_SAMPLE_COUNT; sample_x++) {
+                    lattice->u[index] = (double)x + sample_offsets[sample_x];
+                    lattice->v[index] = (double)y + sample_offsets[sample_y];
+                    lattice->weights[index] = weights[y * size + x];
+                    index++;
+                }
+            }
+        }
+    }
+
+    for (; index < count; index++) {
+        lattice->u[index] = 0.0;
+        lattice->v[index] = 0.0;
+        lattice->weights[index] = 0;
+    }
+
+    lfree(weights);
+
+    return true;
+}
+
+/*
+ * Maps CELL_LATTICE_BATCH grid points through a homography. The vector paths repeat perspective_map() lane for lane in
+ * double precision, so every build maps a point to the same pixel; conversion saturates where the target allows it.
+ */
+static inline void map_grid_batch(const double *coeffs, const double *u, const double *v, int32_t *xs, int32_t *ys)
+{
+#if LIERRE_USE_SIMD && defined(LIERRE_SIMD_AVX2)
+    __m256d uu, vv, one, rounding, denominator, x, y;
+
+    uu = _mm256_loadu_pd(u);
+    vv = _mm256_loadu_pd(v);
+    one = _mm256_set1_pd(1.0);
+    rounding = _mm256_set1_pd(ROUNDING_OFFSET);
+
+    denominator = _mm256_div_pd(one, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(coeffs[6]), uu),
+                                                                 _mm256_mul_pd(_mm256_set1_pd(coeffs[7]), vv)),
+                                                   one));
+    x = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(coeffs[0]), uu),
+                                                  _mm256_mul_pd(_mm256_set1_pd(coeffs[1]), vv)),
+                                    _mm256_set1_pd(coeffs[2])),
+                      denominator);
+    y = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(coeffs[3]), uu),
+                                                  _mm256_mul_pd(_mm256_set1_pd(coeffs[4]), vv)),
+                                    _mm256_set1_pd(coeffs[5])),
+                      denominator);
+
+    _mm_storeu_si128((__m128i *)xs, _mm256_cvttpd_epi32(_mm256_add_pd(x, rounding)));
+    _mm_storeu_si128((__m128i *)ys, _mm256_cvttpd_epi32(_mm256_add_pd(y, rounding)));
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_NEON) && defined(__aarch64__)
+    float64x2_t uu, vv, one, rounding, denominator, x, y;
+    int32_t half;
+
+    one = vdupq_n_f64(1.0);
+    rounding = vdupq_n_f64(ROUNDING_OFFSET);
+
+    for (half = 0; half < CELL_LATTICE_BATCH; half += 2) {
+        uu = vld1q_f64(u + half);
+        vv = vld1q_f64(v + half);
+
+        denominator = vdivq_f64(
+            one, vaddq_f64(vaddq_f64(vmulq_n_f64(uu, coeffs[6]), vmulq_n_f64(vv, coeffs[7])), one));
+        x = vmulq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(uu, coeffs[0]), vmulq_n_f64(vv, coeffs[1])),
+                                vdupq_n_f64(coeffs[2])),
+                      denominator);
+        y = vmulq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(uu, coeffs[3]), vmulq_n_f64(vv, coeffs[4])),
+                                vdupq_n_f64(coeffs[5])),
+                      denominator);
+
+        /* Saturating, so far off-image points stay out of bounds instead of wrapping back in. */
+        vst1_s32(xs + half, vqmovn_s64(vcvtq_s64_f64(vaddq_f64(x, rounding))));
+        vst1_s32(ys + half, vqmovn_s64(vcvtq_s64_f64(vaddq_f64(y, rounding))));
+    }
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_WASM)
+    v128_t uu, vv, one, rounding, denominator, x, y, xi, yi;
+    int32_t half;
+
+    one = wasm_f64x2_splat(1.0);
+    rounding = wasm_f64x2_splat(ROUNDING_OFFSET);
+
+    for (half = 0; half < CELL_LATTICE_BATCH; half += 2) {
+        uu = wasm_v128_load(u + half);
+        vv = wasm_v128_load(v + half);
+
+        denominator = wasm_f64x2_div(
+            one, wasm_f64x2_add(wasm_f64x2_add(wasm_f64x2_mul(wasm_f64x2_splat(coeffs[6]), uu),
+                                               wasm_f64x2_mul(wasm_f64x2_splat(coeffs[7]), vv)),
+                                one));
+        x = wasm_f64x2_mul(wasm_f64x2_add(wasm_f64x2_add(wasm_f64x2_mul(wasm_f64x2_splat(coeffs[0]), uu),
+                                                         wasm_f64x2_mul(wasm_f64x2_splat(coeffs[1]), vv)),
+                                          wasm_f64x2_splat(coeffs[2])),
+                           denominator);
+        y = wasm_f64x2_mul(wasm_f64x2_add(wasm_f64x2_add(wasm_f64x2_mul(wasm_f64x2_splat(coeffs[3]), uu),
+                                                         wasm_f64x2_mul(wasm_f64x2_splat(coeffs[4]), vv)),
+                                          wasm_f64x2_splat(coeffs[5])),
+                           denominator);
+
+        xi = wasm_i32x4_trunc_sat_f64x2_zero(wasm_f64x2_add(x, rounding));
+        yi = wasm_i32x4_trunc_sat_f64x2_zero(wasm_f64x2_add(y, rounding));
+        xs[half] = wasm_i32x4_extract_lane(xi, 0);
+        xs[half + 1] = wasm_i32x4_extract_lane(xi, 1);
+        ys[half] = wasm_i32x4_extract_lane(yi, 0);
+        ys[half + 1] = wasm_i32x4_extract_lane(yi, 1);
+    }
+#else
+    decoder_point_t image_point;
+    int32_t lane;
+
+    for (lane = 0; lane < CELL_LATTICE_BATCH; lane++) {
+        perspective_map(coeffs, u[lane], v[lane], &image_point);
+        xs[lane] = image_point.x;
+        ys[lane] = image_point.y;
+    }
+#endif
+}
+
+static inline int32_t compute_total_grid_fitness(const decoder_t *decoder, int32_t grid_index)
+{
+    const grid_t *grid;
+    const grid_lattice_t *lattice;
+    decoder_point_t image_point;
+    int32_t version, score, xs[CELL_LATTICE_BATCH], ys[CELL_LATTICE_BATCH], lane;
+    size_t i;
+
+    grid = &decoder->grids[grid_index];
+    version = (grid->grid_size - QR_VERSION1_SIZE) / QR_VERSION_SIZE_INCREMENT;
+
+    if (version < QR_VERSION_MIN || version > LIERRE_DECODER_MAX_VERSION || !decoder->lattices[version].u) {
+        return 0;
+    }
+
+    lattice = &decoder->lattices[version];
+    score = 0;
+
+    for (i = 0; i < lattice->count; i += CELL_LATTICE_BATCH) {
+        map_grid_batch(grid->c, lattice->u + i, lattice->v + i, xs, ys);
+
+        for (lane = 0; lane < CELL_LATTICE_BATCH; lane++) {
+            image_point.x = xs[lane];
+            image_point.y = ys[lane];
+            score += sample_grid_pixel(decoder, &image_point) * lattice->weights[i + (size_t)lane];
         }
     }
 
     return score;
 }
 
-static inline void refine_perspective(decoder_t *decoder, int32_t grid_index)
+void refine_qr_grid(decoder_t *decoder, int32_t grid_index)
 {
     grid_t *grid;
     int32_t best_fitness, pass, i, j, test_fitness;
     double adjustment_steps[LIERRE_DECODER_PERSPECTIVE_PARAMS], original_value, step, new_value;
 
     grid = &decoder->grids[grid_index];
-    best_fitness = compute_total_grid_fitness(decoder, grid_index);
+    best_fitness = grid->fitness;
+    grid->refine_steps = 0;
+    grid->refine_limited = false;
 
     for (i = 0; i < LIERRE_DECODER_PERSPECTIVE_PARAMS; i++) {
         adjustment_steps[i] = grid->c[i] * PERSPECTIVE_ADJUSTMENT_FACTOR;
@@ -376,6 +529,11 @@ static inline void refine_perspective(decoder_t *decoder, int32_t grid_index)
 
     for (pass = 0; pass < PERSPECTIVE_REFINEMENT_PASSES; pass++) {
         for (i = 0; i < PERSPECTIVE_PARAM_ITERATIONS; i++) {
+            if (grid->refine_steps >= grid->refine_budget) {
+                grid->refine_limited = true;
+                return;
+            }
+
             j = i >> 1;
             original_value = grid->c[j];
             step = adjustment_steps[j];
@@ -383,9 +541,11 @@ static inline void refine_perspective(decoder_t *decoder, int32_t grid_index)
 
             grid->c[j] = new_value;
             test_fitness = compute_total_grid_fitness(decoder, grid_index);
+            grid->refine_steps++;
 
             if (test_fitness > best_fitness) {
                 best_fitness = test_fitness;
+                grid->fitness = test_fitness;
             } else {
                 grid->c[j] = original_value;
             }
@@ -397,22 +557,18 @@ static inline void refine_perspective(decoder_t *decoder, int32_t grid_index)
     }
 }
 
-static inline void find_leftmost_point_callback(void *user_data, int32_t y, int32_t left, int32_t right)
+static inline void find_leftmost_point_callback(void *user_data, int32_t x, int32_t y)
 {
     corner_finder_data_t *finder;
-    int32_t x_coords[2], i, distance;
+    int32_t distance;
 
     finder = (corner_finder_data_t *)user_data;
-    x_coords[0] = left;
-    x_coords[1] = right;
-
-    for (i = 0; i < 2; i++) {
-        distance = -finder->reference.y * x_coords[i] + finder->reference.x * y;
-        if (distance < finder->scores[0]) {
-            finder->scores[0] = distance;
-            finder->corners[0].x = x_coords[i];
-            finder->corners[0].y = y;
-        }
+    distance = -finder->reference.y * x + finder->reference.x * y;
+
+    if (distance < finder->scores[0]) {
+        finder->scores[0] = distance;
+        finder->corners[0].x = x;
+        finder->corners[0].y = y;
     }
 }
 
@@ -482,7 +638,9 @@ static inline void setup_grid_perspective(decoder_t *decoder, int32_t grid_index
 
     perspective_setup(grid->c, corner_points, (double)(grid->grid_size - FINDER_PATTERN_SIZE),
                       (double)(grid->grid_size - FINDER_PATTERN_SIZE));
-    refine_perspective(decoder, grid_index);
+
+    /* Refinement is left to the decode stage so grids that turn out to be duplicates never pay for it. */
+    grid->fitness = compute_total_grid_fitness(decoder, grid_index);
 }
 
 static inline void rotate_capstone_corners(capstone_t *capstone, const decoder_point_t *origin,
@@ -512,19 +670,53 @@ static inline void rotate_capstone_corners(capstone_t *capstone, const decoder_p
     perspective_setup(capstone->c, capstone->corners, (double)FINDER_PATTERN_SIZE, (double)FINDER_PATTERN_SIZE);
 }
 
+static inline bool grid_has_capstone(const grid_t *grid, int32_t capstone_index)
+{
+    return grid->caps[0] == capstone_index || grid->caps[1] == capstone_index || grid->caps[2] == capstone_index;
+}
+
+static inline void discard_last_grid(decoder_t *decoder)
+{
+    grid_t *grid;
+    int32_t i;
+
+    grid = &decoder->grids[decoder->num_grids - 1];
+    for (i = 0; i < NUM_CAPSTONES; i++) {
+        decoder->capstones[grid->caps[i]].qr_grid = -1;
+    }
+
+    decoder->num_grids--;
+}
+
 static inline void create_qr_grid(decoder_t *decoder, int32_t cap_a, int32_t cap_b, int32_t cap_c)
 {
     decoder_point_t origin, direction;
-    grid_t *grid;
+    grid_t *grids, *grid;
     capstone_t *capstone;
     region_t *region;
     corner_finder_data_t finder;
     int32_t i, grid_index, temp;
 
-    if (decoder->num_grids >= LIERRE_DECODER_MAX_GRIDS) {
+    for (i = 0; i < decoder->num_grids; i++) {
+        if (grid_has_capstone(&decoder->grids[i], cap_a) && grid_has_capstone(&decoder->grids[i], cap_b) &&
+            grid_has_capstone(&decoder->grids[i], cap_c)) {
+            return;
+        }
+    }
+
+    if (decoder->limits.max_grids && (uint32_t)decoder->num_grids >= decoder->limits.max_grids) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_GRIDS;
         return;
     }
 
+    grids = decoder_array_reserve(decoder->grids, &decoder->grids_capacity, (size_t)decoder->num_grids + 1,
+                                  sizeof(grid_t));
+    if (!grids) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_GRIDS;
+        return;
+    }
+    decoder->grids = grids;
+
     origin = decoder->capstones[cap_a].center;
     direction.x = decoder->capstones[cap_c].center.x - decoder->capstones[cap_a].center.x;
     direction.y = decoder->capstones[cap_c].center.y - decoder->capstones[cap_a].center.y;
@@ -559,12 +751,13 @@ static inline void create_qr_grid(decoder_t *decoder, int32_t cap_a, int32_t cap
     if (!compute_line_intersection(&decoder->capstones[cap_a].corners[0], &decoder->capstones[cap_a].corners[1],
                                    &decoder->capstones[cap_c].corners[0], &decoder->capstones[cap_c].corners[3],
                                    &grid->align)) {
-        for (i = 0; i < NUM_CAPSTONES; i++) {
-            decoder->capstones[grid->caps[i]].qr_grid = -1;
-        }
-
-        decoder->num_grids--;
+        discard_last_grid(decoder);
+        return;
+    }
 
+    if (!build_grid_lattice(decoder, (grid->grid_size - QR_VERSION1_SIZE) / QR_VERSION_SIZE_INCREMENT)) {
+        decoder->limits_hit |= LIERRE_READER_LIMIT_GRIDS;
+        discard_last_grid(decoder);
         return;
     }
 
@@ -580,20 +773,140 @@ static inline void create_qr_grid(decoder_t *decoder, int32_t cap_a, int32_t cap
             finder.corners = &grid->align;
             finder.scores[0] = -direction.y * grid->align.x + direction.x * grid->align.y;
 
-            flood_fill_seed(decoder, region->seed.x, region->seed.y, (lierre_pixel_t)grid->align_region,
-                            LIERRE_PIXEL_BLACK, NULL, NULL);
-            flood_fill_seed(decoder, region->seed.x, region->seed.y, LIERRE_PIXEL_BLACK,
-                            (lierre_pixel_t)grid->align_region, find_leftmost_point_callback, &finder);
+            region_for_each_extreme(decoder, grid->align_region, find_leftmost_point_callback, &finder);
         }
     }
 
     setup_grid_perspective(decoder, grid_index);
 }
 
+bool order_qr_grids(decoder_t *decoder)
+{
+    int32_t *order, i, j, grid_index;
+
+    order = decoder_array_reserve(decoder->grid_order, &decoder->grid_order_capacity, (size_t)decoder->num_grids,
+                                  sizeof(int32_t));
+    if (!order) {
+        return false;
+    }
+    decoder->grid_order = order;
+
+    /* Stable, so grids of equal fitness keep their creation order. */
+    for (i = 0; i < decoder->num_grids; i++) {
+        grid_index = i;
+        for (j = i; j > 0 && decoder->grids[order[j - 1]].fitness < decoder->grids[grid_index].fitness; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = grid_index;
+    }
+
+    return true;
+}
+
+static inline bool grid_contains_point(const grid_t *grid, const decoder_point_t *point)
+{
+    decoder_point_t corners[NUM_CORNERS];
+    int64_t cross;
+    int32_t i, sign, side;
+
+    perspective_map(grid->c, 0.0, 0.0, &corners[0]);
+    perspective_map(grid->c, (double)grid->grid_size, 0.0, &corners[1]);
+    perspective_map(grid->c, (double)grid->grid_size, (double)grid->grid_size, &corners[2]);
+    perspective_map(grid->c, 0.0, (double)grid->grid_size, &corners[3]);
+
+    sign = 0;
+    for (i = 0; i < NUM_CORNERS; i++) {
+        cross = (int64_t)(corners[(i + 1) % NUM_CORNERS].x - corners[i].x) * (point->y - corners[i].y) -
+                (int64_t)(corners[(i + 1) % NUM_CORNERS].y - corners[i].y) * (point->x - corners[i].x);
+        side = cross > 0 ? 1 : (cross < 0 ? -1 : 0);
+        if (side != 0 && sign != 0 && side != sign) {
+            return false;
+        }
+        if (side != 0) {
+            sign = side;
+        }
+    }
+
+    return true;
+}
+
+bool qr_grid_is_duplicate(const decoder_t *decoder, int32_t grid_index)
+{
+    const grid_t *grid, *other;
+    decoder_point_t center;
+    int32_t i;
+
+    grid = &decoder->grids[grid_index];
+    perspective_map(grid->c, (double)grid->grid_size * AVERAGE_FACTOR, (double)grid->grid_size * AVERAGE_FACTOR,
+                    &center);
+
+    /* A capstone belongs to one symbol only, and a symbol's centre lies inside no other symbol. */
+    for (i = 0; i < decoder->num_grids; i++) {
+        other = &decoder->grids[i];
+        if (i == grid_index || !other->decoded) {
+            continue;
+        }
+
+        if (grid_has_capstone(other, grid->caps[0]) || grid_has_capstone(other, grid->caps[1]) ||
+            grid_has_capstone(other, grid->caps[2]) || grid_contains_point(other, &center)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * The pixel colour is folded into the bit arithmetically, since dark and light cells are close to evenly mixed and a
+ * branch on it would mispredict. Only the rarely taken out-of-image check is a branch.
+ */
+static inline void store_cell_bit(const decoder_t *decoder, const decoder_point_t *image_point, qr_code_t *code,
+                                  int32_t bit_index)
+{
+    if (image_point->y < 0 || image_point->y >= decoder->h || image_point->x < 0 || image_point->x >= decoder->w) {
+        return;
+    }
+
+    code->cell_bitmap[bit_index >> 3] |=
+        (uint8_t)((decoder->pixels[image_point->y * decoder->w + image_point->x] == LIERRE_PIXEL_BLACK)
+                  << (bit_index & 7));
+}
+
+/*
+ * Samples the cell centres of one row. Along a row the homography numerators and denominator are affine in u,
+ * so they are stepped by one column instead of being evaluated from scratch, leaving one divide per cell.
+ */
+static inline void sample_grid_row(const decoder_t *decoder, const double *coeffs, int32_t row, qr_code_t *code)
+{
+    decoder_point_t image_point;
+    double u, v, numerator_x, numerator_y, denominator, scale;
+    int32_t bit_index, col;
+
+    u = CELL_CENTER_OFFSET;
+    v = (double)row + CELL_CENTER_OFFSET;
+    numerator_x = coeffs[0] * u + coeffs[1] * v + coeffs[2];
+    numerator_y = coeffs[3] * u + coeffs[4] * v + coeffs[5];
+    denominator = coeffs[6] * u + coeffs[7] * v + 1.0;
+    bit_index = row * code->size;
+
+    for (col = 0; col < code->size; col++) {
+        scale = 1.0 / denominator;
+        image_point.x = (int32_t)(numerator_x * scale + ROUNDING_OFFSET);
+        image_point.y = (int32_t)(numerator_y * scale + ROUNDING_OFFSET);
+
+        store_cell_bit(decoder, &image_point, code, bit_index);
+
+        numerator_x += coeffs[0];
+        numerator_y += coeffs[3];
+        denominator += coeffs[6];
+        bit_index++;
+    }
+}
+
 void extract_qr_code(const decoder_t *decoder, int32_t grid_index, qr_code_t *code)
 {
     const grid_t *grid;
-    int32_t row, col, bit_index;
+    int32_t row;
 
     lmemset(code, 0, sizeof(*code));
 
@@ -614,14 +927,8 @@ void extract_qr_code(const decoder_t *decoder, int32_t grid_index, qr_code_t *co
         return;
     }
 
-    bit_index = 0;
-    for (row = 0; row < grid->grid_size; row++) {
-        for (col = 0; col < grid->grid_size; col++) {
-            if (read_grid_cell(decoder, grid_index, col, row) > 0) {
-                code->cell_bitmap[bit_index >> 3] |= (1 << (bit_index & 7));
-            }
-            bit_index++;
-        }
+    for (row = 0; row < code->size; row++) {
+        sample_grid_row(decoder, grid->c, row, code);
     }
 }
 
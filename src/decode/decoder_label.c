@@ -0,0 +1,490 @@
+/*
+ * liblierre - decoder_label.c
+ *
+ * This file is part of liblierre.
+ *
+ * Author: Go Kudo <zeriyoshi@gmail.com>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../internal/decoder.h"
+
+#if LIERRE_USE_SIMD
+#include "../internal/simd.h"
+#endif
+
+#define LABEL_RUN_NONE                UINT32_MAX
+#define LABEL_STRIPE_INITIAL_CAPACITY 256
+
+/*
+ * Extreme-point directions, counter-clockwise from +x. The axis entries double as the bounding box. Corner and
+ * alignment searches score only these points. Their results are therefore approximate, not the exact span-walk
+ * maximum: a maximiser in an arbitrary direction is a hull vertex that may lie between two stored directions, so
+ * corners are found to within one direction step (about 22.5 degrees).
+ */
+static const int32_t extreme_dx[LIERRE_DECODER_REGION_EXTREMES] = {2, 2, 1, 1, 0, -1, -1, -2,
+                                                                   -2, -2, -1, -1, 0, 1, 1, 2},
+                     extreme_dy[LIERRE_DECODER_REGION_EXTREMES] = {0, 1, 1, 2, 2, 2, 1, 1,
+                                                                   0, -1, -1, -2, -2, -2, -1, -1};
+
+static inline uint32_t run_find(pixel_run_t *runs, uint32_t index)
+{
+    while (runs[index].parent != index) {
+        runs[index].parent = runs[runs[index].parent].parent;
+        index = runs[index].parent;
+    }
+
+    return index;
+}
+
+static inline void run_union(pixel_run_t *runs, uint32_t a, uint32_t b)
+{
+    a = run_find(runs, a);
+    b = run_find(runs, b);
+
+    /* The lowest run index becomes the root, so roots always precede their members. */
+    if (a < b) {
+        runs[b].parent = a;
+    } else if (b < a) {
+        runs[a].parent = b;
+    }
+}
+
+static inline void run_union_rows(pixel_run_t *runs, uint32_t above, uint32_t above_end, uint32_t below,
+                                  uint32_t below_end)
+{
+    while (above < above_end && below < below_end) {
+        if (runs[above].right >= runs[below].left && runs[below].right >= runs[above].left) {
+            run_union(runs, above, below);
+        }
+
+        if (runs[above].right < runs[below].right) {
+            above++;
+        } else {
+            below++;
+        }
+    }
+}
+
+static bool stripe_grow_runs(decoder_stripe_t *stripe)
+{
+    pixel_run_t *runs;
+    size_t capacity;
+
+    capacity = stripe->runs_capacity ? stripe->runs_capacity * 2 : LABEL_STRIPE_INITIAL_CAPACITY;
+    if (capacity >= LABEL_RUN_NONE) {
+        return false;
+    }
+
+    runs = lmalloc(sizeof(pixel_run_t) * capacity);
+    if (!runs) {
+        return false;
+    }
+
+    if (stripe->runs) {
+        lmemcpy(runs, stripe->runs, sizeof(pixel_run_t) * stripe->num_runs);
+        lfree(stripe->runs);
+    }
+
+    stripe->runs = runs;
+    stripe->runs_capacity = capacity;
+
+    return true;
+}
+
+static inline bool stripe_push_run(decoder_stripe_t *stripe, int32_t left, int32_t right)
+{
+    pixel_run_t *run;
+
+    if (stripe->num_runs >= stripe->runs_capacity && !stripe_grow_runs(stripe)) {
+        return false;
+    }
+
+    run = &stripe->runs[stripe->num_runs];
+    run->left = left;
+    run->right = right;
+    run->parent = (uint32_t)stripe->num_runs;
+    stripe->num_runs++;
+
+    return true;
+}
+
+static inline bool row_toggle(decoder_stripe_t *stripe, int32_t x, int32_t *left, bool *black)
+{
+    *black = !*black;
+    if (*black) {
+        *left = x;
+        return true;
+    }
+
+    return stripe_push_run(stripe, *left, x - 1);
+}
+
+static inline void stats_init(region_stats_t *stats, int32_t y, int32_t left, int32_t right)
+{
+    int32_t i;
+
+    for (i = 0; i < LIERRE_DECODER_REGION_EXTREMES; i++) {
+        stats->extremes[i].x = extreme_dx[i] > 0 ? right : left;
+        stats->extremes[i].y = y;
+    }
+}
+
+static inline void stats_add_run(region_stats_t *stats, int32_t y, int32_t left, int32_t right)
+{
+    decoder_point_t *extreme;
+    int32_t i, x;
+
+    for (i = 0; i < LIERRE_DECODER_REGION_EXTREMES; i++) {
+        extreme = &stats->extremes[i];
+        x = extreme_dx[i] > 0 ? right : left;
+
+        if (extreme_dx[i] * x + extreme_dy[i] * y > extreme_dx[i] * extreme->x + extreme_dy[i] * extreme->y) {
+            extreme->x = x;
+            extreme->y = y;
+        }
+    }
+}
+
+static inline bool reserve_components(decoder_t *decoder, size_t count)
+{
+    region_component_t *components;
+
+    if (count <= decoder->components_capacity) {
+        return true;
+    }
+
+    components = lmalloc(sizeof(region_component_t) * count);
+    if (!components) {
+        return false;
+    }
+
+    if (decoder->components) {
+        lfree(decoder->components);
+    }
+
+    decoder->components = components;
+    decoder->components_capacity = count;
+
+    return true;
+}
+
+static inline bool reserve_stats(decoder_t *decoder, size_t count)
+{
+    region_stats_t *stats;
+
+    if (count <= decoder->stats_capacity) {
+        return true;
+    }
+
+    stats = lmalloc(sizeof(region_stats_t) * count);
+    if (!stats) {
+        return false;
+    }
+
+    if (decoder->stats) {
+        lfree(decoder->stats);
+    }
+
+    decoder->stats = stats;
+    decoder->stats_capacity = count;
+
+    return true;
+}
+
+static inline bool reserve_runs(decoder_t *decoder, size_t count)
+{
+    pixel_run_t *runs;
+
+    if (count <= decoder->runs_capacity) {
+        return true;
+    }
+
+    runs = lmalloc(sizeof(pixel_run_t) * count);
+    if (!runs) {
+        return false;
+    }
+
+    if (decoder->runs) {
+        lfree(decoder->runs);
+    }
+
+    decoder->runs = runs;
+    decoder->runs_capacity = count;
+
+    return true;
+}
+
+static void label_relocate_task(void *arg, uint32_t index)
+{
+    decoder_t *decoder;
+    decoder_stripe_t *stripe;
+    pixel_run_t *run;
+    uint32_t offset, y;
+    size_t i;
+
+    decoder = (decoder_t *)arg;
+    stripe = &decoder->stripes[index];
+    offset = (uint32_t)stripe->run_offset;
+
+    lmemcpy(decoder->runs + offset, stripe->runs, sizeof(pixel_run_t) * stripe->num_runs);
+
+    for (i = 0; i < stripe->num_runs; i++) {
+        run = &decoder->runs[offset + i];
+        run->parent += offset;
+    }
+
+    for (y = stripe->row_begin; y < stripe->row_end; y++) {
+        decoder->row_runs[y] += offset;
+    }
+}
+
+bool label_binarize_row(decoder_t *decoder, decoder_stripe_t *stripe, uint32_t y)
+{
+    const uint8_t *gray;
+    lierre_pixel_t *row, pixel;
+    uint32_t first;
+    int32_t x, left;
+    uint8_t threshold;
+    bool black;
+
+    gray = decoder->image + (size_t)y * (size_t)decoder->w;
+    row = decoder->pixels + (size_t)y * (size_t)decoder->w;
+    threshold = decoder->threshold;
+    first = (uint32_t)stripe->num_runs;
+    decoder->row_runs[y] = first;
+    x = 0;
+    left = 0;
+    black = false;
+
+    /* Each block yields a colour mask; XOR with itself shifted by one pixel leaves the colour changes. */
+#if LIERRE_USE_SIMD && defined(LIERRE_SIMD_AVX2)
+    {
+        __m256i thresh_vec, black_vec, zero_vec, result;
+        uint32_t mask, transitions;
+
+        thresh_vec = _mm256_set1_epi8((char)threshold);
+        black_vec = _mm256_set1_epi8((char)LIERRE_PIXEL_BLACK);
+        zero_vec = _mm256_setzero_si256();
+
+        for (; x + 32 <= decoder->w; x += 32) {
+            result = _mm256_min_epu8(_mm256_subs_epu8(thresh_vec, _mm256_loadu_si256((const __m256i *)(gray + x))),
+                                     black_vec);
+            _mm256_storeu_si256((__m256i *)(row + x), result);
+
+            mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(result, zero_vec));
+            transitions = mask ^ ((mask << 1) | (uint32_t)black);
+
+            while (transitions) {
+                if (!row_toggle(stripe, x + (int32_t)simd_ctz32(transitions), &left, &black)) {
+                    return false;
+                }
+                transitions &= transitions - 1;
+            }
+        }
+    }
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_NEON)
+    {
+        uint8x16_t thresh_vec, black_vec, compare;
+        uint64_t mask, transitions;
+
+        thresh_vec = vdupq_n_u8(threshold);
+        black_vec = vdupq_n_u8(LIERRE_PIXEL_BLACK);
+
+        for (; x + 16 <= decoder->w; x += 16) {
+            compare = vcltq_u8(vld1q_u8(gray + x), thresh_vec);
+            vst1q_u8(row + x, vandq_u8(compare, black_vec));
+
+            /* Narrowing leaves one nibble per pixel; keep one bit of each. */
+            mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(compare), 4)), 0) &
+                   0x1111111111111111ULL;
+            transitions = mask ^ ((mask << 4) | (uint64_t)black);
+
+            while (transitions) {
+                if (!row_toggle(stripe, x + (int32_t)(simd_ctz64(transitions) >> 2), &left, &black)) {
+                    return false;
+                }
+                transitions &= transitions - 1;
+            }
+        }
+    }
+#elif LIERRE_USE_SIMD && defined(LIERRE_SIMD_WASM)
+    {
+        v128_t thresh_vec, black_vec, compare;
+        uint32_t mask, transitions;
+
+        thresh_vec = wasm_u8x16_splat(threshold);
+        black_vec = wasm_u8x16_splat(LIERRE_PIXEL_BLACK);
+
+        for (; x + 16 <= decoder->w; x += 16) {
+            compare = wasm_u8x16_lt(wasm_v128_load(gray + x), thresh_vec);
+            wasm_v128_store(row + x, wasm_v128_and(compare, black_vec));
+
+            mask = (uint32_t)wasm_i8x16_bitmask(compare);
+            transitions = (mask ^ ((mask << 1) | (uint32_t)black)) & 0xFFFF;
+
+            while (transitions) {
+                if (!row_toggle(stripe, x + (int32_t)simd_ctz32(transitions), &left, &black)) {
+                    return false;
+                }
+                transitions &= transitions - 1;
+            }
+        }
+    }
+#endif
+
+    for (; x < decoder->w; x++) {
+        pixel = (gray[x] < threshold) ? LIERRE_PIXEL_BLACK : LIERRE_PIXEL_WHITE;
+        row[x] = pixel;
+
+        if ((pixel == LIERRE_PIXEL_BLACK) != black && !row_toggle(stripe, x, &left, &black)) {
+            return false;
+        }
+    }
+
+    if (black && !stripe_push_run(stripe, left, decoder->w - 1)) {
+        return false;
+    }
+
+    if (y > stripe->row_begin) {
+        run_union_rows(stripe->runs, decoder->row_runs[y - 1], first, first, (uint32_t)stripe->num_runs);
+    }
+
+    return true;
+}
+
+lierre_error_t label_merge_stripes(decoder_t *decoder, const executor_t *executor)
+{
+    decoder_stripe_t *stripe;
+    region_component_t *component;
+    pixel_run_t *run, *runs;
+    size_t total, capacity;
+    uint32_t i, root, y, num_stats;
+
+    total = 0;
+    for (i = 0; i < decoder->num_stripes; i++) {
+        stripe = &decoder->stripes[i];
+        if (stripe->failed) {
+            return LIERRE_ERROR_DATA_OVERFLOW;
+        }
+
+        stripe->run_offset = total;
+        total += stripe->num_runs;
+    }
+
+    /* Only components spanning several runs get statistics, and each of those owns at least two runs. */
+    if (total >= LABEL_RUN_NONE || !reserve_components(decoder, total) || !reserve_stats(decoder, total / 2 + 1)) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
+    }
+
+    if (decoder->num_stripes == 1) {
+        /* A single stripe already holds frame-wide indices, so trade buffers instead of copying. */
+        stripe = &decoder->stripes[0];
+        runs = decoder->runs;
+        capacity = decoder->runs_capacity;
+        decoder->runs = stripe->runs;
+        decoder->runs_capacity = stripe->runs_capacity;
+        stripe->runs = runs;
+        stripe->runs_capacity = capacity;
+    } else {
+        if (!reserve_runs(decoder, total)) {
+            return LIERRE_ERROR_DATA_OVERFLOW;
+        }
+
+        executor_run(executor, label_relocate_task, decoder, decoder->num_stripes);
+
+        for (i = 1; i < decoder->num_stripes; i++) {
+            y = decoder->stripes[i].row_begin;
+            if (y == 0 || y >= (uint32_t)decoder->h) {
+                continue;
+            }
+
+            run_union_rows(decoder->runs, decoder->row_runs[y - 1], decoder->row_runs[y], decoder->row_runs[y],
+                           y + 1 < (uint32_t)decoder->h ? decoder->row_runs[y + 1] : (uint32_t)total);
+        }
+    }
+
+    decoder->num_runs = total;
+    decoder->row_runs[decoder->h] = (uint32_t)total;
+
+    /*
+     * Parents always have lower indices than their children, so one forward pass points every run straight at its
+     * root. The root index doubles as the component id, and the pass gathers each component's statistics.
+     */
+    num_stats = 0;
+    for (y = 0; y < (uint32_t)decoder->h; y++) {
+        for (i = decoder->row_runs[y]; i < decoder->row_runs[y + 1]; i++) {
+            run = &decoder->runs[i];
+            root = decoder->runs[run->parent].parent;
+            run->parent = root;
+
+            component = &decoder->components[root];
+            if (root == i) {
+                component->count = run->right - run->left + 1;
+                component->region = -1;
+                component->y = (int32_t)y;
+                component->stats = LABEL_RUN_NONE;
+                continue;
+            }
+
+            if (component->stats == LABEL_RUN_NONE) {
+                component->stats = num_stats++;
+                stats_init(&decoder->stats[component->stats], component->y, decoder->runs[root].left,
+                           decoder->runs[root].right);
+            }
+
+            component->count += run->right - run->left + 1;
+            stats_add_run(&decoder->stats[component->stats], (int32_t)y, run->left, run->right);
+        }
+    }
+
+    return LIERRE_ERROR_SUCCESS;
+}
+
+int32_t label_component_at(const decoder_t *decoder, int32_t x, int32_t y)
+{
+    uint32_t low, high, middle;
+
+    low = decoder->row_runs[y];
+    high = decoder->row_runs[y + 1];
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (decoder->runs[middle].right < x) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < decoder->row_runs[y + 1] && decoder->runs[low].left <= x) {
+        return (int32_t)decoder->runs[low].parent;
+    }
+
+    return -1;
+}
+
+void region_for_each_extreme(const decoder_t *decoder, int32_t region_id, point_callback_t callback, void *user_data)
+{
+    const region_component_t *component;
+    const region_stats_t *stats;
+    const pixel_run_t *root;
+    uint32_t index;
+    int32_t i;
+
+    index = decoder->regions[region_id].component;
+    component = &decoder->components[index];
+
+    if (component->stats == LABEL_RUN_NONE) {
+        root = &decoder->runs[index];
+        for (i = 0; i < LIERRE_DECODER_REGION_EXTREMES; i++) {
+            callback(user_data, extreme_dx[i] > 0 ? root->right : root->left, component->y);
+        }
+        return;
+    }
+
+    stats = &decoder->stats[component->stats];
+    for (i = 0; i < LIERRE_DECODER_REGION_EXTREMES; i++) {
+        callback(user_data, stats->extremes[i].x, stats->extremes[i].y);
+    }
+}
@@ -15,6 +15,7 @@
 #include <lierre/reader.h>
 
 #include "../internal/decoder.h"
+#include "../internal/executor.h"
 #include "../internal/image.h"
 #include "../internal/memory.h"
 
@@ -174,6 +175,116 @@ static inline void lierre_rgb_to_gray(const uint8_t *src, uint8_t *dst, size_t p
 #endif
 }
 
+static inline bool workspace_reserve(uint8_t **buffer, size_t *capacity, size_t size)
+{
+    uint8_t *new_buffer;
+
+    if (size <= *capacity) {
+        return true;
+    }
+
+    new_buffer = lmalloc(size);
+    if (!new_buffer) {
+        return false;
+    }
+
+    if (*buffer) {
+        lfree(*buffer);
+    }
+
+    *buffer = new_buffer;
+    *capacity = size;
+
+    return true;
+}
+
+static inline lierre_error_t workspace_prepare(reader_workspace_t *workspace, size_t num_pixels)
+{
+    if (!workspace->decoder) {
+        workspace->decoder = lierre_decoder_create();
+        if (!workspace->decoder) {
+            return LIERRE_ERROR_DATA_OVERFLOW;
+        }
+    }
+
+    if (!workspace->result) {
+        workspace->result = lierre_decoder_result_create();
+        if (!workspace->result) {
+            return LIERRE_ERROR_DATA_OVERFLOW;
+        }
+    }
+
+    if (!workspace_reserve(&workspace->gray, &workspace->gray_capacity, num_pixels) ||
+        !workspace_reserve(&workspace->scratch, &workspace->scratch_capacity, num_pixels)) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
+    }
+
+    return LIERRE_ERROR_SUCCESS;
+}
+
+static inline void workspace_release(reader_workspace_t *workspace)
+{
+    if (workspace->decoder) {
+        lierre_decoder_destroy(workspace->decoder);
+    }
+
+    if (workspace->result) {
+        lierre_decoder_result_destroy(workspace->result);
+    }
+
+    if (workspace->gray) {
+        lfree(workspace->gray);
+    }
+
+    if (workspace->scratch) {
+        lfree(workspace->scratch);
+    }
+
+    lmemset(workspace, 0, sizeof(reader_workspace_t));
+}
+
+typedef struct {
+    lierre_reader_t *reader;
+    lierre_rgb_data_t **images;
+    lierre_reader_result_t **results;
+    lierre_error_t *errors;
+    uint32_t num_images;
+    volatile uint32_t next_image;
+} reader_batch_ctx_t;
+
+static void thread_pool_executor(void *executor_ctx, lierre_reader_task_t task, void *task_arg, uint32_t num_tasks)
+{
+    lierre_thread_pool_run((lierre_thread_pool_t *)executor_ctx, task, task_arg, num_tasks);
+}
+
+static inline void reader_executor_prepare(lierre_reader_t *reader, executor_t *executor)
+{
+    executor->run = NULL;
+    executor->ctx = NULL;
+    executor->parallelism = 1;
+
+    if (!(reader->param->strategy_flags & LIERRE_READER_STRATEGY_MT)) {
+        return;
+    }
+
+    executor->parallelism = reader->param->max_parallelism ? reader->param->max_parallelism : lierre_get_cpu_count();
+
+    if (reader->param->executor) {
+        executor->run = reader->param->executor;
+        executor->ctx = reader->param->executor_ctx;
+        return;
+    }
+
+    if (!reader->pool) {
+        reader->pool = lierre_thread_pool_create(executor->parallelism);
+    }
+
+    if (reader->pool) {
+        executor->run = thread_pool_executor;
+        executor->ctx = reader->pool;
+    }
+}
+
 extern lierre_error_t lierre_reader_param_init(lierre_reader_param_t *param)
 {
     if (!param) {
@@ -182,6 +293,10 @@ extern lierre_error_t lierre_reader_param_init(lierre_reader_param_t *param)
 
     param->strategy_flags = LIERRE_READER_STRATEGY_NONE;
     param->rect = NULL;
+    param->executor = NULL;
+    param->executor_ctx = NULL;
+    param->max_parallelism = 0;
+    lmemset(&param->limits, 0, sizeof(param->limits));
 
     return LIERRE_ERROR_SUCCESS;
 }
@@ -204,6 +319,35 @@ extern void lierre_reader_param_set_rect(lierre_reader_param_t *param, const lie
     param->rect = rect;
 }
 
+extern void lierre_reader_param_set_executor(lierre_reader_param_t *param, lierre_reader_executor_t executor,
+                                             void *executor_ctx)
+{
+    if (!param) {
+        return;
+    }
+
+    param->executor = executor;
+    param->executor_ctx = executor_ctx;
+}
+
+extern void lierre_reader_param_set_max_parallelism(lierre_reader_param_t *param, uint32_t max_parallelism)
+{
+    if (!param) {
+        return;
+    }
+
+    param->max_parallelism = max_parallelism;
+}
+
+extern void lierre_reader_param_set_limits(lierre_reader_param_t *param, const lierre_reader_limits_t *limits)
+{
+    if (!param || !limits) {
+        return;
+    }
+
+    param->limits = *limits;
+}
+
 extern lierre_reader_t *lierre_reader_create(const lierre_reader_param_t *param)
 {
     lierre_reader_t *reader;
@@ -218,6 +362,10 @@ extern lierre_reader_t *lierre_reader_create(const lierre_reader_param_t *param)
     }
 
     reader->data = NULL;
+    reader->pool = NULL;
+    reader->batch_workspaces = NULL;
+    reader->num_batch_workspaces = 0;
+    lmemset(&reader->workspace, 0, sizeof(reader_workspace_t));
     reader->param = lmalloc(sizeof(lierre_reader_param_t));
     if (!reader->param) {
         lfree(reader);
@@ -231,6 +379,8 @@ extern lierre_reader_t *lierre_reader_create(const lierre_reader_param_t *param)
 
 extern void lierre_reader_destroy(lierre_reader_t *reader)
 {
+    size_t i;
+
     if (!reader) {
         return;
     }
@@ -239,6 +389,15 @@ extern void lierre_reader_destroy(lierre_reader_t *reader)
         lfree(reader->param);
     }
 
+    workspace_release(&reader->workspace);
+
+    for (i = 0; i < reader->num_batch_workspaces; i++) {
+        workspace_release(&reader->batch_workspaces[i]);
+    }
+    lfree(reader->batch_workspaces);
+
+    lierre_thread_pool_destroy(reader->pool);
+
     lfree(reader);
 }
 
@@ -251,35 +410,28 @@ extern void lierre_reader_set_data(lierre_reader_t *reader, lierre_rgb_data_t *d
     reader->data = data;
 }
 
-extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_result_t **result)
+static lierre_error_t reader_read_image(const lierre_reader_t *reader, reader_workspace_t *workspace,
+                                        const lierre_rgb_data_t *data, const executor_t *executor,
+                                        lierre_reader_result_t **result)
 {
     const uint8_t *pixel;
     lierre_reader_result_t *res;
     decoder_t *decoder;
     decoder_result_t *dec_result;
     lierre_error_t err;
-    uint32_t num_threads, scale, sum, dy, dx, scale_shift, temp;
+    uint32_t scale, sum, dy, dx, scale_shift, temp, num_finder_candidates, num_finder_rejected;
+    lierre_reader_limit_flag_t limits_hit;
     uint8_t *gray_data, *scaled_gray, r, g, b, gray;
     int32_t rect_w, rect_h;
     size_t i, j, start_x, start_y, width, height, src_x, src_y, src_idx, sw, sh, sy, sx, gx, gy;
     bool use_mt, use_quirc_grayscale;
 
-    if (!reader || !result || !reader->data || !reader->data->data) {
-        return LIERRE_ERROR_INVALID_PARAMS;
-    }
-
-    dec_result = lmalloc(sizeof(decoder_result_t));
-    if (!dec_result) {
-        return LIERRE_ERROR_DATA_OVERFLOW;
-    }
-
-    use_mt = (reader->param->strategy_flags & LIERRE_READER_STRATEGY_MT) != 0;
-    num_threads = use_mt ? lierre_get_cpu_count() : 1;
+    use_mt = executor != NULL;
 
     start_x = 0;
     start_y = 0;
-    width = reader->data->width;
-    height = reader->data->height;
+    width = data->width;
+    height = data->height;
 
     if ((reader->param->strategy_flags & LIERRE_READER_STRATEGY_USE_RECT) && reader->param->rect) {
         start_x = reader->param->rect->origin.x;
@@ -287,32 +439,36 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
         width = reader->param->rect->size.width;
         height = reader->param->rect->size.height;
         if (width == 0 || height == 0 || width > SIZE_MAX / height) {
-            lfree(dec_result);
             return LIERRE_ERROR_INVALID_PARAMS;
         }
     }
 
-    gray_data = lmalloc(width * height);
-    if (!gray_data) {
-        lfree(dec_result);
-        return LIERRE_ERROR_DATA_OVERFLOW;
+    err = workspace_prepare(workspace, width * height);
+    if (err != LIERRE_ERROR_SUCCESS) {
+        return err;
     }
 
-    if (start_x == 0 && start_y == 0 && width == reader->data->width && height == reader->data->height) {
-        lierre_rgb_to_gray(reader->data->data, gray_data, width * height);
+    decoder = workspace->decoder;
+    decoder->limits = reader->param->limits;
+    decoder->lazy_refine = (reader->param->strategy_flags & LIERRE_READER_STRATEGY_LAZY_REFINE) != 0;
+    dec_result = workspace->result;
+    gray_data = workspace->gray;
+
+    if (start_x == 0 && start_y == 0 && width == data->width && height == data->height) {
+        lierre_rgb_to_gray(data->data, gray_data, width * height);
     } else {
         for (i = 0; i < height; i++) {
             for (j = 0; j < width; j++) {
                 src_x = start_x + j;
                 src_y = start_y + i;
-                if (src_x >= reader->data->width || src_y >= reader->data->height) {
+                if (src_x >= data->width || src_y >= data->height) {
                     gray_data[i * width + j] = LIERRE_PIXEL_VALUE_DEFAULT;
                     continue;
                 }
-                src_idx = (src_y * reader->data->width + src_x) * 3;
-                r = reader->data->data[src_idx];
-                g = reader->data->data[src_idx + 1];
-                b = reader->data->data[src_idx + 2];
+                src_idx = (src_y * data->width + src_x) * 3;
+                r = data->data[src_idx];
+                g = data->data[src_idx + 1];
+                b = data->data[src_idx + 2];
                 gray = (uint8_t)((r * LIERRE_GRAY_WEIGHT_R + g * LIERRE_GRAY_WEIGHT_G + b * LIERRE_GRAY_WEIGHT_B) >>
                                  LIERRE_GRAY_SHIFT);
                 gray_data[i * width + j] = gray;
@@ -322,9 +478,9 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
 
     if (reader->param->strategy_flags & LIERRE_READER_STRATEGY_DENOISE) {
         if (use_mt) {
-            image_denoise_mt(gray_data, width, height, num_threads);
+            image_denoise_mt(gray_data, workspace->scratch, width, height, executor);
         } else {
-            image_denoise(gray_data, width, height);
+            image_denoise(gray_data, workspace->scratch, width, height);
         }
     }
 
@@ -338,21 +494,16 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
 
     if (reader->param->strategy_flags & LIERRE_READER_STRATEGY_SHARPENING) {
         if (use_mt) {
-            image_sharpen_mt(gray_data, width, height, num_threads);
+            image_sharpen_mt(gray_data, workspace->scratch, width, height, executor);
         } else {
-            image_sharpen(gray_data, width, height);
+            image_sharpen(gray_data, workspace->scratch, width, height);
         }
     }
 
-    decoder = lierre_decoder_create();
-    if (!decoder) {
-        lfree(gray_data);
-        lfree(dec_result);
-
-        return LIERRE_ERROR_DATA_OVERFLOW;
-    }
-
     dec_result->count = 0;
+    num_finder_candidates = 0;
+    num_finder_rejected = 0;
+    limits_hit = LIERRE_READER_LIMIT_NONE;
 
     if (reader->param->strategy_flags & LIERRE_READER_STRATEGY_MINIMIZE) {
         use_quirc_grayscale = (reader->param->strategy_flags & LIERRE_READER_STRATEGY_GRAYSCALE) != 0;
@@ -373,10 +524,7 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
             }
             scale_shift *= 2;
 
-            scaled_gray = lmalloc(sw * sh);
-            if (!scaled_gray) {
-                break;
-            }
+            scaled_gray = workspace->scratch;
 
             if (use_quirc_grayscale) {
                 for (sy = 0; sy < sh; sy++) {
@@ -386,12 +534,12 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
                             for (dx = 0; dx < scale; dx++) {
                                 src_x = start_x + sx * scale + dx;
                                 src_y = start_y + sy * scale + dy;
-                                if (src_x >= reader->data->width || src_y >= reader->data->height) {
+                                if (src_x >= data->width || src_y >= data->height) {
                                     sum += LIERRE_PIXEL_VALUE_DEFAULT;
                                     continue;
                                 }
-                                src_idx = (src_y * reader->data->width + src_x) * 3;
-                                pixel = reader->data->data + src_idx;
+                                src_idx = (src_y * data->width + src_x) * 3;
+                                pixel = data->data + src_idx;
                                 sum += (pixel[0] * LIERRE_GRAY_WEIGHT_R + pixel[1] * LIERRE_GRAY_WEIGHT_G +
                                         pixel[2] * LIERRE_GRAY_WEIGHT_B) >>
                                        LIERRE_GRAY_SHIFT;
@@ -421,42 +569,41 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
             }
 
             if (use_mt) {
-                err =
-                    lierre_decoder_process_mt(decoder, scaled_gray, (int32_t)sw, (int32_t)sh, dec_result, num_threads);
+                err = lierre_decoder_process_mt(decoder, scaled_gray, (int32_t)sw, (int32_t)sh, dec_result, executor);
             } else {
                 err = lierre_decoder_process(decoder, scaled_gray, (int32_t)sw, (int32_t)sh, dec_result);
             }
 
-            lfree(scaled_gray);
+            if (err != LIERRE_ERROR_SUCCESS) {
+                continue;
+            }
+
+            num_finder_candidates += dec_result->num_finder_candidates;
+            num_finder_rejected += dec_result->num_finder_rejected;
+            limits_hit |= dec_result->limits_hit;
 
-            if (err == LIERRE_ERROR_SUCCESS && dec_result->count > 0) {
+            if (dec_result->count > 0) {
                 break;
             }
         }
-
-        lfree(gray_data);
     } else {
         if (use_mt) {
-            err =
-                lierre_decoder_process_mt(decoder, gray_data, (int32_t)width, (int32_t)height, dec_result, num_threads);
+            err = lierre_decoder_process_mt(decoder, gray_data, (int32_t)width, (int32_t)height, dec_result, executor);
         } else {
             err = lierre_decoder_process(decoder, gray_data, (int32_t)width, (int32_t)height, dec_result);
         }
-        lfree(gray_data);
 
         if (err != LIERRE_ERROR_SUCCESS) {
-            lfree(dec_result);
-            lierre_decoder_destroy(decoder);
-
             return err;
         }
+
+        num_finder_candidates = dec_result->num_finder_candidates;
+        num_finder_rejected = dec_result->num_finder_rejected;
+        limits_hit = dec_result->limits_hit;
     }
 
     res = lmalloc(sizeof(lierre_reader_result_t));
     if (!res) {
-        lfree(dec_result);
-        lierre_decoder_destroy(decoder);
-
         return LIERRE_ERROR_DATA_OVERFLOW;
     }
 
@@ -464,6 +611,9 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
     res->qr_code_rects = NULL;
     res->qr_code_datas = NULL;
     res->qr_code_data_sizes = NULL;
+    res->num_finder_candidates = num_finder_candidates;
+    res->num_finder_rejected = num_finder_rejected;
+    res->limits_hit = limits_hit;
 
     if (dec_result->count > 0) {
         res->qr_code_rects = lcalloc(dec_result->count, sizeof(lierre_rect_t));
@@ -475,8 +625,6 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
             lfree(res->qr_code_datas);
             lfree(res->qr_code_data_sizes);
             lfree(res);
-            lfree(dec_result);
-            lierre_decoder_destroy(decoder);
 
             return LIERRE_ERROR_DATA_OVERFLOW;
         }
@@ -499,13 +647,130 @@ extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_
         }
     }
 
-    lfree(dec_result);
-    lierre_decoder_destroy(decoder);
     *result = res;
 
     return LIERRE_ERROR_SUCCESS;
 }
 
+extern lierre_error_t lierre_reader_read(lierre_reader_t *reader, lierre_reader_result_t **result)
+{
+    executor_t executor;
+
+    if (!reader || !result || !reader->data || !reader->data->data) {
+        return LIERRE_ERROR_INVALID_PARAMS;
+    }
+
+    if (!(reader->param->strategy_flags & LIERRE_READER_STRATEGY_MT)) {
+        return reader_read_image(reader, &reader->workspace, reader->data, NULL, result);
+    }
+
+    reader_executor_prepare(reader, &executor);
+
+    return reader_read_image(reader, &reader->workspace, reader->data, &executor, result);
+}
+
+static inline bool reader_batch_reserve(lierre_reader_t *reader, size_t num_workspaces)
+{
+    reader_workspace_t *workspaces;
+
+    if (num_workspaces <= reader->num_batch_workspaces) {
+        return true;
+    }
+
+    workspaces = lcalloc(num_workspaces, sizeof(reader_workspace_t));
+    if (!workspaces) {
+        return false;
+    }
+
+    if (reader->batch_workspaces) {
+        lmemcpy(workspaces, reader->batch_workspaces, sizeof(reader_workspace_t) * reader->num_batch_workspaces);
+        lfree(reader->batch_workspaces);
+    }
+
+    reader->batch_workspaces = workspaces;
+    reader->num_batch_workspaces = num_workspaces;
+
+    return true;
+}
+
+static void reader_batch_task(void *arg, uint32_t index)
+{
+    reader_batch_ctx_t *ctx;
+    reader_workspace_t *workspace;
+    const lierre_rgb_data_t *data;
+    uint32_t image;
+
+    ctx = (reader_batch_ctx_t *)arg;
+    workspace = (index == 0) ? &ctx->reader->workspace : &ctx->reader->batch_workspaces[index - 1];
+
+    while ((image = lierre_atomic_fetch_add(&ctx->next_image, 1)) < ctx->num_images) {
+        data = ctx->images[image];
+        if (!data || !data->data) {
+            ctx->errors[image] = LIERRE_ERROR_INVALID_PARAMS;
+            continue;
+        }
+
+        ctx->errors[image] = reader_read_image(ctx->reader, workspace, data, NULL, &ctx->results[image]);
+        if (ctx->errors[image] != LIERRE_ERROR_SUCCESS) {
+            ctx->results[image] = NULL;
+        }
+    }
+}
+
+extern lierre_error_t lierre_reader_read_batch(lierre_reader_t *reader, lierre_rgb_data_t **images, size_t num_images,
+                                               lierre_reader_result_t **results)
+{
+    reader_batch_ctx_t ctx;
+    executor_t executor;
+    lierre_error_t err;
+    uint32_t num_tasks;
+    size_t i;
+
+    if (!reader || !images || !results || num_images > UINT32_MAX) {
+        return LIERRE_ERROR_INVALID_PARAMS;
+    }
+
+    for (i = 0; i < num_images; i++) {
+        results[i] = NULL;
+    }
+
+    if (num_images == 0) {
+        return LIERRE_ERROR_SUCCESS;
+    }
+
+    reader_executor_prepare(reader, &executor);
+    num_tasks = executor_task_count(&executor, num_images);
+
+    if (!reader_batch_reserve(reader, num_tasks - 1)) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
+    }
+
+    ctx.errors = lmalloc(sizeof(lierre_error_t) * num_images);
+    if (!ctx.errors) {
+        return LIERRE_ERROR_DATA_OVERFLOW;
+    }
+
+    ctx.reader = reader;
+    ctx.images = images;
+    ctx.results = results;
+    ctx.num_images = (uint32_t)num_images;
+    ctx.next_image = 0;
+
+    executor_run(&executor, reader_batch_task, &ctx, num_tasks);
+
+    err = LIERRE_ERROR_SUCCESS;
+    for (i = 0; i < num_images; i++) {
+        if (ctx.errors[i] != LIERRE_ERROR_SUCCESS) {
+            err = ctx.errors[i];
+            break;
+        }
+    }
+
+    lfree(ctx.errors);
+
+    return err;
+}
+
 extern void lierre_reader_result_destroy(lierre_reader_result_t *result)
 {
     uint32_t i;
@@ -569,3 +834,30 @@ extern size_t lierre_reader_result_get_qr_code_data_size(const lierre_reader_res
 
     return result->qr_code_data_sizes[index];
 }
+
+extern uint32_t lierre_reader_result_get_num_finder_candidates(const lierre_reader_result_t *result)
+{
+    if (!result) {
+        return 0;
+    }
+
+    return result->num_finder_candidates;
+}
+
+extern uint32_t lierre_reader_result_get_num_finder_rejected(const lierre_reader_result_t *result)
+{
+    if (!result) {
+        return 0;
+    }
+
+    return result->num_finder_rejected;
+}
+
+extern lierre_reader_limit_flag_t lierre_reader_result_get_limits_hit(const lierre_reader_result_t *result)
+{
+    if (!result) {
+        return LIERRE_READER_LIMIT_NONE;
+    }
+
+    return result->limits_hit;
+}
@@ -11,15 +11,17 @@
 #include <string.h>
 
 #include <lierre.h>
+#include <lierre/portable.h>
 #include <lierre/writer.h>
 
-#include <poporon.h>
-
 #include "../internal/memory.h"
 #include "../internal/structs.h"
 
 #define RS_GF256_PRIMITIVE_POLY 0x11D
 #define RS_GF256_GENERATOR_ROOT 0x1
+#define RS_GF256_ALPHA          0x2
+#define RS_GF256_SIZE           256
+#define RS_GF256_ORDER          255
 #define RS_BYTE_BITS            7
 
 #define FORMAT_POLY            0x537
@@ -356,6 +358,117 @@ static const int16_t CHAR_CAPACITY[4][41][4] = {
     },
 };
 
+typedef struct {
+    uint8_t exp[RS_GF256_ORDER * 2];
+    uint8_t log[RS_GF256_SIZE];
+    uint8_t divisors[QR_RS_DEGREE_MAX + 1][QR_RS_DEGREE_MAX];
+} rs_encoder_table_t;
+
+typedef struct {
+    uint8_t *modules;
+    uint8_t *patterns;
+    uint16_t *placement;
+    int32_t num_bits;
+    uint8_t *mask_planes;
+    size_t mask_bytes;
+    volatile uint32_t ready;
+} function_template_t;
+
+static rs_encoder_table_t rs_encoder_table;
+static lierre_once_t rs_encoder_table_once = LIERRE_ONCE_INIT;
+static function_template_t function_templates[QR_VERSION_MAX + 1];
+static lierre_mutex_t function_template_lock;
+static bool function_template_lock_ready;
+static lierre_once_t function_template_once = LIERRE_ONCE_INIT;
+
+static inline uint8_t rs_multiply(uint8_t x, uint8_t y)
+{
+    int32_t i;
+    uint8_t z;
+
+    z = 0;
+    for (i = RS_BYTE_BITS; i >= 0; i--) {
+        z = (uint8_t)((z << 1) ^ ((z >> RS_BYTE_BITS) * RS_GF256_PRIMITIVE_POLY));
+        z ^= ((y >> i) & 1) * x;
+    }
+
+    return z;
+}
+
+static inline void rs_compute_divisor(int32_t degree, uint8_t result[])
+{
+    int32_t i, j;
+    uint8_t root;
+
+    lmemset(result, 0, (size_t)degree);
+    result[degree - 1] = 1;
+
+    root = RS_GF256_GENERATOR_ROOT;
+    for (i = 0; i < degree; i++) {
+        for (j = 0; j < degree; j++) {
+            result[j] = rs_multiply(result[j], root);
+            if (j + 1 < degree) {
+                result[j] ^= result[j + 1];
+            }
+        }
+        root = rs_multiply(root, RS_GF256_ALPHA);
+    }
+}
+
+static void rs_encoder_table_init(void)
+{
+    bool built[QR_RS_DEGREE_MAX + 1] = {false};
+    int32_t i, ecl, version, degree;
+    uint8_t x;
+
+    x = 1;
+    for (i = 0; i < RS_GF256_ORDER; i++) {
+        rs_encoder_table.exp[i] = x;
+        rs_encoder_table.exp[i + RS_GF256_ORDER] = x;
+        rs_encoder_table.log[x] = (uint8_t)i;
+        x = rs_multiply(x, RS_GF256_ALPHA);
+    }
+
+    for (ecl = 0; ecl < 4; ecl++) {
+        for (version = QR_VERSION_MIN; version <= QR_VERSION_MAX; version++) {
+            degree = ECC_CODEWORDS_PER_BLOCK[ecl][version];
+            if (degree < 1 || degree > QR_RS_DEGREE_MAX || built[degree]) {
+                continue;
+            }
+
+            rs_compute_divisor(degree, rs_encoder_table.divisors[degree]);
+            built[degree] = true;
+        }
+    }
+}
+
+static inline void rs_compute_remainder(const uint8_t data[], int32_t data_len, int32_t degree, uint8_t result[])
+{
+    const uint8_t *divisor;
+    int32_t i, j, factor_log;
+    uint8_t factor;
+
+    divisor = rs_encoder_table.divisors[degree];
+    lmemset(result, 0, (size_t)degree);
+
+    for (i = 0; i < data_len; i++) {
+        factor = data[i] ^ result[0];
+        lmemmove(&result[0], &result[1], (size_t)(degree - 1));
+        result[degree - 1] = 0;
+
+        if (factor == 0) {
+            continue;
+        }
+
+        factor_log = rs_encoder_table.log[factor];
+        for (j = 0; j < degree; j++) {
+            if (divisor[j]) {
+                result[j] ^= rs_encoder_table.exp[rs_encoder_table.log[divisor[j]] + factor_log];
+            }
+        }
+    }
+}
+
 static inline void append_bits(uint32_t val, uint8_t num_bits, uint8_t buffer[], int32_t *bit_len)
 {
     int32_t i;
@@ -392,11 +505,13 @@ static inline int32_t get_num_data_codewords(uint8_t version, uint8_t ecl)
 static inline bool add_ecc_and_interleave(uint8_t data[], uint8_t version, uint8_t ecl, uint8_t result[])
 {
     const uint8_t *dat;
-    poporon_t *pprn;
-    poporon_config_t *config;
     uint8_t num_blocks, block_ecc_len, num_short_blocks, short_block_data_len, *ecc;
     int32_t raw_codewords, data_len, i, j, k, dat_len;
 
+    if (lierre_once(&rs_encoder_table_once, rs_encoder_table_init) != 0) {
+        return false;
+    }
+
     num_blocks = NUM_ERROR_CORRECTION_BLOCKS[ecl][version];
     block_ecc_len = ECC_CODEWORDS_PER_BLOCK[ecl][version];
     raw_codewords = get_num_raw_data_modules(version) >> 3;
@@ -404,24 +519,13 @@ static inline bool add_ecc_and_interleave(uint8_t data[], uint8_t version, uint8
     num_short_blocks = num_blocks - raw_codewords % num_blocks;
     short_block_data_len = raw_codewords / num_blocks - block_ecc_len;
 
-    config = poporon_rs_config_create(8, RS_GF256_PRIMITIVE_POLY, 0, 1, block_ecc_len, NULL, NULL);
-    if (!config) {
-        return false;
-    }
-
-    pprn = poporon_create(config);
-    if (!pprn) {
-        poporon_config_destroy(config);
-        return false;
-    }
-
     dat = data;
 
     for (i = 0; i < num_blocks; i++) {
         dat_len = short_block_data_len + (i < num_short_blocks ? 0 : 1);
         ecc = &data[data_len];
 
-        poporon_encode(pprn, (uint8_t *)dat, (size_t)dat_len, ecc);
+        rs_compute_remainder(dat, dat_len, block_ecc_len, ecc);
 
         for (j = 0, k = i; j < dat_len; j++, k += num_blocks) {
             if (j == short_block_data_len) {
@@ -437,8 +541,6 @@ static inline bool add_ecc_and_interleave(uint8_t data[], uint8_t version, uint8
         dat += dat_len;
     }
 
-    poporon_destroy(pprn);
-    poporon_config_destroy(config);
     return true;
 }
 
@@ -647,12 +749,12 @@ static inline void draw_format_bits(uint8_t ecl, int8_t mask, uint8_t qrcode[])
     set_module(qrcode, 8, qrsize - FINDER_QUIET_SIZE, true);
 }
 
-static inline void draw_codewords(const uint8_t data[], int32_t data_len, uint8_t qrcode[])
+static inline void build_codeword_placement(const uint8_t function_modules[], uint16_t placement[], int32_t num_bits)
 {
     int32_t qrsize, bit_idx, right, vert, j, x, y;
-    bool upward, dark;
+    bool upward;
 
-    qrsize = qrcode[0];
+    qrsize = function_modules[0];
     bit_idx = 0;
 
     for (right = qrsize - 1; right >= 1; right -= 2) {
@@ -666,62 +768,88 @@ static inline void draw_codewords(const uint8_t data[], int32_t data_len, uint8_
                 upward = ((right + 1) & 2) == 0;
                 y = upward ? qrsize - 1 - vert : vert;
 
-                if (!get_module(qrcode, x, y) && bit_idx < data_len * 8) {
-                    dark = ((data[bit_idx >> 3] >> (7 - (bit_idx & 7))) & 1) != 0;
-                    set_module(qrcode, x, y, dark);
-                    bit_idx++;
+                if (!get_module(function_modules, x, y) && bit_idx < num_bits) {
+                    placement[bit_idx++] = (uint16_t)(y * qrsize + x);
                 }
             }
         }
     }
 }
 
-static inline void apply_mask(const uint8_t function_modules[], uint8_t qrcode[], int8_t mask)
+/* Data modules start light in the pattern template, so placing a codeword bit only ever has to set it. */
+static inline void draw_codewords(const uint16_t placement[], int32_t num_bits, const uint8_t data[], uint8_t qrcode[])
 {
-    int32_t qrsize, y, x;
-    bool invert, val;
+    int32_t bit_idx, index;
+    uint8_t dark;
 
-    qrsize = qrcode[0];
+    for (bit_idx = 0; bit_idx < num_bits; bit_idx++) {
+        index = placement[bit_idx];
+        dark = (uint8_t)((data[bit_idx >> 3] >> (7 - (bit_idx & 7))) & 1);
+        qrcode[(index >> 3) + 1] |= (uint8_t)(dark << (index & 7));
+    }
+}
+
+static inline bool mask_inverts(int8_t mask, int32_t x, int32_t y)
+{
+    switch (mask) {
+    case 0:
+        return (x + y) % 2 == 0;
+    case 1:
+        return y % 2 == 0;
+    case 2:
+        return x % 3 == 0;
+    case 3:
+        return (x + y) % 3 == 0;
+    case 4:
+        return (x / 3 + y / 2) % 2 == 0;
+    case 5:
+        return x * y % 2 + x * y % 3 == 0;
+    case 6:
+        return (x * y % 2 + x * y % 3) % 2 == 0;
+    case 7:
+        return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    default:
+        return false;
+    }
+}
+
+static inline void build_mask_plane(const uint8_t function_modules[], uint8_t plane[], int8_t mask)
+{
+    int32_t qrsize, x, y, index;
+
+    qrsize = function_modules[0];
 
     for (y = 0; y < qrsize; y++) {
         for (x = 0; x < qrsize; x++) {
-            if (get_module(function_modules, x, y)) {
-                continue;
+            if (!get_module(function_modules, x, y) && mask_inverts(mask, x, y)) {
+                index = y * qrsize + x;
+                plane[index >> 3] |= (uint8_t)(1 << (index & 7));
             }
+        }
+    }
+}
 
-            switch (mask) {
-            case 0:
-                invert = (x + y) % 2 == 0;
-                break;
-            case 1:
-                invert = y % 2 == 0;
-                break;
-            case 2:
-                invert = x % 3 == 0;
-                break;
-            case 3:
-                invert = (x + y) % 3 == 0;
-                break;
-            case 4:
-                invert = (x / 3 + y / 2) % 2 == 0;
-                break;
-            case 5:
-                invert = x * y % 2 + x * y % 3 == 0;
-                break;
-            case 6:
-                invert = (x * y % 2 + x * y % 3) % 2 == 0;
-                break;
-            case 7:
-                invert = ((x + y) % 2 + x * y % 3) % 2 == 0;
-                break;
-            default:
-                invert = false;
-                break;
-            }
+/* Planes hold only data modules, so one XOR applies a mask and a second one removes it again. */
+static inline void apply_mask(const function_template_t *function_template, uint8_t qrcode[], int8_t mask)
+{
+    uint64_t word, mask_word;
+    const uint8_t *plane;
+    uint8_t *modules;
+    size_t i, plane_len;
 
-            val = get_module(qrcode, x, y);
-            set_module(qrcode, x, y, val ^ invert);
-        }
+    plane_len = function_template->mask_bytes;
+    plane = function_template->mask_planes + (size_t)mask * plane_len;
+    modules = qrcode + 1;
+
+    for (i = 0; i + sizeof(word) <= plane_len; i += sizeof(word)) {
+        lmemcpy(&word, modules + i, sizeof(word));
+        lmemcpy(&mask_word, plane + i, sizeof(mask_word));
+        word ^= mask_word;
+        lmemcpy(modules + i, &word, sizeof(word));
+    }
+
+    for (; i < plane_len; i++) {
+        modules[i] ^= plane[i];
     }
 }
 
@@ -869,6 +997,123 @@ static inline bool is_numeric_data(const uint8_t *data, size_t data_len)
     return true;
 }
 
+static inline bool function_template_build(function_template_t *entry, uint8_t version)
+{
+    uint8_t *buffers;
+    size_t len, placement_size, mask_bytes;
+    int32_t num_bits, i;
+
+    len = (size_t)QR_BUFFER_LEN_FOR_VERSION(version);
+    num_bits = (get_num_raw_data_modules(version) >> 3) * 8;
+    placement_size = (size_t)num_bits * sizeof(uint16_t);
+    mask_bytes = len - 1;
+
+    /* The placement map, both templates and the mask planes share one allocation, owned through placement. */
+    buffers = lmalloc(placement_size + len * 2 + mask_bytes * QR_MASK_COUNT);
+    if (!buffers) {
+        return false;
+    }
+
+    entry->placement = (uint16_t *)buffers;
+    entry->modules = buffers + placement_size;
+    entry->patterns = entry->modules + len;
+    entry->mask_planes = entry->patterns + len;
+    entry->num_bits = num_bits;
+    entry->mask_bytes = mask_bytes;
+
+    initialize_function_modules(version, entry->modules);
+    initialize_function_modules(version, entry->patterns);
+    draw_light_function_modules(entry->patterns, version);
+    build_codeword_placement(entry->modules, entry->placement, num_bits);
+
+    lmemset(entry->mask_planes, 0, mask_bytes * QR_MASK_COUNT);
+    for (i = 0; i < QR_MASK_COUNT; i++) {
+        build_mask_plane(entry->modules, entry->mask_planes + (size_t)i * mask_bytes, (int8_t)i);
+    }
+
+    return true;
+}
+
+static void function_template_lock_init(void)
+{
+    function_template_lock_ready = lierre_mutex_init(&function_template_lock) == 0;
+}
+
+/*
+ * Templates are built on first use of a version and shared by every writer for the lifetime of the process. Writers
+ * only take the lock to build one; afterwards the ready flag publishes it with release/acquire ordering.
+ */
+static inline const function_template_t *get_function_template(uint8_t version)
+{
+    function_template_t *entry;
+    bool ready;
+
+    entry = &function_templates[version];
+    if (lierre_atomic_load(&entry->ready)) {
+        return entry;
+    }
+
+    if (lierre_once(&function_template_once, function_template_lock_init) != 0 || !function_template_lock_ready) {
+        return NULL;
+    }
+
+    lierre_mutex_lock(&function_template_lock);
+    ready = entry->modules || function_template_build(entry, version);
+    if (ready) {
+        lierre_atomic_store(&entry->ready, 1);
+    }
+    lierre_mutex_unlock(&function_template_lock);
+
+    return ready ? entry : NULL;
+}
+
+static inline bool draw_symbol(uint8_t temp_buffer[], uint8_t qrcode[], uint8_t version, uint8_t ecl, int8_t mask)
+{
+    const function_template_t *function_template;
+    uint8_t best_mask;
+    int32_t i, min_penalty, penalty;
+
+    if (mask >= QR_MASK_COUNT) {
+        return false;
+    }
+
+    if (!add_ecc_and_interleave(qrcode, version, ecl, temp_buffer)) {
+        return false;
+    }
+
+    function_template = get_function_template(version);
+    if (!function_template) {
+        return false;
+    }
+
+    lmemcpy(qrcode, function_template->patterns, (size_t)QR_BUFFER_LEN_FOR_VERSION(version));
+    draw_codewords(function_template->placement, function_template->num_bits, temp_buffer, qrcode);
+
+    if (mask < 0) {
+        min_penalty = INT32_MAX;
+        best_mask = 0;
+
+        for (i = 0; i < QR_MASK_COUNT; i++) {
+            apply_mask(function_template, qrcode, (int8_t)i);
+            draw_format_bits(ecl, (int8_t)i, qrcode);
+            penalty = get_penalty_score(qrcode);
+
+            if (penalty < min_penalty) {
+                best_mask = (int8_t)i;
+                min_penalty = penalty;
+            }
+
+            apply_mask(function_template, qrcode, (int8_t)i);
+        }
+        mask = best_mask;
+    }
+
+    apply_mask(function_template, qrcode, mask);
+    draw_format_bits(ecl, mask, qrcode);
+
+    return true;
+}
+
 static inline int32_t numeric_count_bits(uint8_t version, size_t char_count)
 {
     int32_t count_bits;
@@ -890,8 +1135,8 @@ static inline int32_t numeric_count_bits(uint8_t version, size_t char_count)
 static inline bool encode_numeric(const uint8_t *data, size_t data_len, uint8_t temp_buffer[], uint8_t qrcode[],
                                   uint8_t ecl, int8_t min_version, int8_t max_version, int8_t mask)
 {
-    uint8_t pad_byte, version, best_mask;
-    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i, min_penalty, penalty, count_bits, value;
+    uint8_t pad_byte, version;
+    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, count_bits, value;
     size_t idx;
 
     for (version = min_version;; version++) {
@@ -950,37 +1195,7 @@ static inline bool encode_numeric(const uint8_t *data, size_t data_len, uint8_t
         append_bits(pad_byte, QR_PAD_BYTE_BITS, qrcode, &bit_len);
     }
 
-    if (!add_ecc_and_interleave(qrcode, version, ecl, temp_buffer)) {
-        return false;
-    }
-    initialize_function_modules(version, qrcode);
-    draw_codewords(temp_buffer, get_num_raw_data_modules(version) >> 3, qrcode);
-    draw_light_function_modules(qrcode, version);
-    initialize_function_modules(version, temp_buffer);
-
-    if (mask < 0) {
-        min_penalty = INT32_MAX;
-        best_mask = 0;
-
-        for (i = 0; i < QR_MASK_COUNT; i++) {
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-            draw_format_bits(ecl, (int8_t)i, qrcode);
-            penalty = get_penalty_score(qrcode);
-
-            if (penalty < min_penalty) {
-                best_mask = (int8_t)i;
-                min_penalty = penalty;
-            }
-
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-        }
-        mask = best_mask;
-    }
-
-    apply_mask(temp_buffer, qrcode, mask);
-    draw_format_bits(ecl, mask, qrcode);
-
-    return true;
+    return draw_symbol(temp_buffer, qrcode, version, ecl, mask);
 }
 
 static inline int8_t alphanumeric_char_value(uint8_t c)
@@ -1050,8 +1265,8 @@ static inline int32_t alphanumeric_count_bits(uint8_t version, size_t char_count
 static inline bool encode_alphanumeric(const uint8_t *data, size_t data_len, uint8_t temp_buffer[], uint8_t qrcode[],
                                        uint8_t ecl, int8_t min_version, int8_t max_version, int8_t mask)
 {
-    uint8_t pad_byte, version, best_mask;
-    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i, min_penalty, penalty, count_bits, value;
+    uint8_t pad_byte, version;
+    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, count_bits, value;
     size_t idx;
 
     for (version = min_version;; version++) {
@@ -1107,38 +1322,7 @@ static inline bool encode_alphanumeric(const uint8_t *data, size_t data_len, uin
         append_bits(pad_byte, QR_PAD_BYTE_BITS, qrcode, &bit_len);
     }
 
-    if (!add_ecc_and_interleave(qrcode, version, ecl, temp_buffer)) {
-        return false;
-    }
-
-    initialize_function_modules(version, qrcode);
-    draw_codewords(temp_buffer, get_num_raw_data_modules(version) >> 3, qrcode);
-    draw_light_function_modules(qrcode, version);
-    initialize_function_modules(version, temp_buffer);
-
-    if (mask < 0) {
-        min_penalty = INT32_MAX;
-        best_mask = 0;
-
-        for (i = 0; i < QR_MASK_COUNT; i++) {
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-            draw_format_bits(ecl, (int8_t)i, qrcode);
-            penalty = get_penalty_score(qrcode);
-
-            if (penalty < min_penalty) {
-                best_mask = (int8_t)i;
-                min_penalty = penalty;
-            }
-
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-        }
-        mask = best_mask;
-    }
-
-    apply_mask(temp_buffer, qrcode, mask);
-    draw_format_bits(ecl, mask, qrcode);
-
-    return true;
+    return draw_symbol(temp_buffer, qrcode, version, ecl, mask);
 }
 
 static inline bool is_kanji_byte_pair(uint8_t high, uint8_t low)
@@ -1187,9 +1371,9 @@ static inline bool encode_kanji(const uint8_t *data, size_t data_len, uint8_t te
                                 uint8_t ecl, int8_t min_version, int8_t max_version, int8_t mask)
 {
     uint16_t sjis_char;
-    uint8_t pad_byte, version, best_mask;
-    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i, min_penalty, penalty, count_bits,
-        high_byte, low_byte, intermediate, encoded_value;
+    uint8_t pad_byte, version;
+    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, count_bits, high_byte, low_byte, intermediate,
+        encoded_value;
     size_t idx, char_count;
 
     char_count = data_len / 2;
@@ -1251,37 +1435,7 @@ static inline bool encode_kanji(const uint8_t *data, size_t data_len, uint8_t te
         append_bits(pad_byte, QR_PAD_BYTE_BITS, qrcode, &bit_len);
     }
 
-    if (!add_ecc_and_interleave(qrcode, version, ecl, temp_buffer)) {
-        return false;
-    }
-    initialize_function_modules(version, qrcode);
-    draw_codewords(temp_buffer, get_num_raw_data_modules(version) >> 3, qrcode);
-    draw_light_function_modules(qrcode, version);
-    initialize_function_modules(version, temp_buffer);
-
-    if (mask < 0) {
-        min_penalty = INT32_MAX;
-        best_mask = 0;
-
-        for (i = 0; i < QR_MASK_COUNT; i++) {
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-            draw_format_bits(ecl, (int8_t)i, qrcode);
-            penalty = get_penalty_score(qrcode);
-
-            if (penalty < min_penalty) {
-                best_mask = (int8_t)i;
-                min_penalty = penalty;
-            }
-
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-        }
-        mask = best_mask;
-    }
-
-    apply_mask(temp_buffer, qrcode, mask);
-    draw_format_bits(ecl, mask, qrcode);
-
-    return true;
+    return draw_symbol(temp_buffer, qrcode, version, ecl, mask);
 }
 
 static inline int32_t eci_header_bits(uint32_t eci_value)
@@ -1298,8 +1452,8 @@ static inline int32_t eci_header_bits(uint32_t eci_value)
 static inline bool encode_eci(const uint8_t *data, size_t data_len, uint8_t temp_buffer[], uint8_t qrcode[],
                               uint8_t ecl, int8_t min_version, int8_t max_version, int8_t mask, uint32_t eci_value)
 {
-    uint8_t pad_byte, version, best_mask;
-    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i, min_penalty, penalty, ehb;
+    uint8_t pad_byte, version;
+    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i, ehb;
 
     ehb = eci_header_bits(eci_value);
 
@@ -1357,44 +1511,14 @@ static inline bool encode_eci(const uint8_t *data, size_t data_len, uint8_t temp
         append_bits(pad_byte, QR_PAD_BYTE_BITS, qrcode, &bit_len);
     }
 
-    if (!add_ecc_and_interleave(qrcode, version, ecl, temp_buffer)) {
-        return false;
-    }
-    initialize_function_modules(version, qrcode);
-    draw_codewords(temp_buffer, get_num_raw_data_modules(version) >> 3, qrcode);
-    draw_light_function_modules(qrcode, version);
-    initialize_function_modules(version, temp_buffer);
-
-    if (mask < 0) {
-        min_penalty = INT32_MAX;
-        best_mask = 0;
-
-        for (i = 0; i < QR_MASK_COUNT; i++) {
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-            draw_format_bits(ecl, (int8_t)i, qrcode);
-            penalty = get_penalty_score(qrcode);
-
-            if (penalty < min_penalty) {
-                best_mask = (int8_t)i;
-                min_penalty = penalty;
-            }
-
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-        }
-        mask = best_mask;
-    }
-
-    apply_mask(temp_buffer, qrcode, mask);
-    draw_format_bits(ecl, mask, qrcode);
-
-    return true;
+    return draw_symbol(temp_buffer, qrcode, version, ecl, mask);
 }
 
 static inline bool encode_binary(const uint8_t *data, size_t data_len, uint8_t temp_buffer[], uint8_t qrcode[],
                                  uint8_t ecl, int8_t min_version, int8_t max_version, int8_t mask)
 {
-    uint8_t pad_byte, version, best_mask;
-    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i, min_penalty, penalty;
+    uint8_t pad_byte, version;
+    int32_t data_capacity_bits, data_used_bits, bit_len, terminator_bits, i;
 
     for (version = min_version;; version++) {
         data_capacity_bits = get_num_data_codewords(version, ecl) * QR_PAD_BYTE_BITS;
@@ -1436,37 +1560,7 @@ static inline bool encode_binary(const uint8_t *data, size_t data_len, uint8_t t
         append_bits(pad_byte, QR_PAD_BYTE_BITS, qrcode, &bit_len);
     }
 
-    if (!add_ecc_and_interleave(qrcode, version, ecl, temp_buffer)) {
-        return false;
-    }
-    initialize_function_modules(version, qrcode);
-    draw_codewords(temp_buffer, get_num_raw_data_modules(version) >> 3, qrcode);
-    draw_light_function_modules(qrcode, version);
-    initialize_function_modules(version, temp_buffer);
-
-    if (mask < 0) {
-        min_penalty = INT32_MAX;
-        best_mask = 0;
-
-        for (i = 0; i < QR_MASK_COUNT; i++) {
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-            draw_format_bits(ecl, (int8_t)i, qrcode);
-            penalty = get_penalty_score(qrcode);
-
-            if (penalty < min_penalty) {
-                best_mask = (int8_t)i;
-                min_penalty = penalty;
-            }
-
-            apply_mask(temp_buffer, qrcode, (int8_t)i);
-        }
-        mask = best_mask;
-    }
-
-    apply_mask(temp_buffer, qrcode, mask);
-    draw_format_bits(ecl, mask, qrcode);
-
-    return true;
+    return draw_symbol(temp_buffer, qrcode, version, ecl, mask);
 }
 
 extern lierre_error_t lierre_writer_param_init(lierre_writer_param_t *param, uint8_t *data, size_t data_size,
@@ -1477,6 +1571,10 @@ extern lierre_error_t lierre_writer_param_init(lierre_writer_param_t *param, uin
         return LIERRE_ERROR_INVALID_PARAMS;
     }
 
+    if (mask_pattern < MASK_AUTO || mask_pattern > MASK_7) {
+        return LIERRE_ERROR_INVALID_PARAMS;
+    }
+
     param->data = data;
     param->data_size = data_size;
     param->scale = scale;
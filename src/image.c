@@ -31,8 +31,8 @@ typedef struct {
     uint8_t *dst;
     size_t src_width;
     size_t dst_width;
-    size_t start_row;
-    size_t end_row;
+    size_t dst_height;
+    uint32_t num_tasks;
 } lierre_image_mt_minimize_ctx_t;
 
 typedef struct {
@@ -40,8 +40,7 @@ typedef struct {
     uint8_t *temp;
     size_t width;
     size_t height;
-    size_t start_row;
-    size_t end_row;
+    uint32_t num_tasks;
 } lierre_image_mt_filter_ctx_t;
 
 #define LIERRE_IMAGE_MT_MAX_THREADS          64
@@ -400,20 +399,41 @@ static inline int64_t lierre_sum(const uint8_t *image, size_t total)
 #endif
 }
 
-static inline void *minimize_thread(void *arg)
+static inline void task_row_range(size_t height, uint32_t num_tasks, uint32_t index, size_t *start_row,
+                                  size_t *end_row)
+{
+    size_t rows_per_task;
+
+    rows_per_task = height / num_tasks;
+    *start_row = index * rows_per_task;
+    *end_row = (index == num_tasks - 1) ? height : (index + 1) * rows_per_task;
+}
+
+static inline uint32_t task_count(const executor_t *executor, size_t height)
+{
+    uint32_t num_tasks;
+
+    num_tasks = executor_task_count(executor, height);
+    if (num_tasks > LIERRE_IMAGE_MT_MAX_THREADS) {
+        num_tasks = LIERRE_IMAGE_MT_MAX_THREADS;
+    }
+
+    return num_tasks;
+}
+
+static void minimize_task(void *arg, uint32_t index)
 {
     lierre_image_mt_minimize_ctx_t *ctx;
-    size_t y, src_y;
+    size_t y, src_y, start_row, end_row;
 
     ctx = (lierre_image_mt_minimize_ctx_t *)arg;
+    task_row_range(ctx->dst_height, ctx->num_tasks, index, &start_row, &end_row);
 
-    for (y = ctx->start_row; y < ctx->end_row; y++) {
+    for (y = start_row; y < end_row; y++) {
         src_y = y * 2;
         lierre_minimize_row(ctx->src + src_y * ctx->src_width, ctx->src + (src_y + 1) * ctx->src_width,
                             ctx->dst + y * ctx->dst_width, ctx->dst_width);
     }
-
-    return NULL;
 }
 
 static inline uint8_t *apply_minimize_once(const uint8_t *image, size_t width, size_t height, size_t *out_width,
@@ -448,13 +468,11 @@ static inline uint8_t *apply_minimize_once(const uint8_t *image, size_t width, s
 }
 
 static inline uint8_t *apply_minimize_once_mt(const uint8_t *image, size_t width, size_t height, size_t *out_width,
-                                              size_t *out_height, uint32_t num_threads)
+                                              size_t *out_height, const executor_t *executor)
 {
-    lierre_thread_t *threads;
-    lierre_image_mt_minimize_ctx_t *contexts;
-    uint32_t i;
+    lierre_image_mt_minimize_ctx_t ctx;
     uint8_t *result;
-    size_t new_width, new_height, rows_per_thread;
+    size_t new_width, new_height;
 
     new_width = width >> 1;
     new_height = height >> 1;
@@ -465,48 +483,19 @@ static inline uint8_t *apply_minimize_once_mt(const uint8_t *image, size_t width
         return NULL;
     }
 
-    if (num_threads > LIERRE_IMAGE_MT_MAX_THREADS) {
-        num_threads = LIERRE_IMAGE_MT_MAX_THREADS;
-    }
-    if (num_threads > new_height) {
-        num_threads = (uint32_t)new_height;
-    }
-    if (num_threads < 1) {
-        num_threads = 1;
-    }
-
     result = lmalloc(new_width * new_height);
     if (!result) {
         return NULL;
     }
 
-    threads = lmalloc(sizeof(lierre_thread_t) * num_threads);
-    contexts = lmalloc(sizeof(lierre_image_mt_minimize_ctx_t) * num_threads);
-    if (!threads || !contexts) {
-        lfree(result);
-        lfree(threads);
-        lfree(contexts);
-        return NULL;
-    }
+    ctx.src = image;
+    ctx.dst = result;
+    ctx.src_width = width;
+    ctx.dst_width = new_width;
+    ctx.dst_height = new_height;
+    ctx.num_tasks = task_count(executor, new_height);
 
-    rows_per_thread = new_height / num_threads;
-
-    for (i = 0; i < num_threads; i++) {
-        contexts[i].src = image;
-        contexts[i].dst = result;
-        contexts[i].src_width = width;
-        contexts[i].dst_width = new_width;
-        contexts[i].start_row = i * rows_per_thread;
-        contexts[i].end_row = (i == num_threads - 1) ? new_height : (i + 1) * rows_per_thread;
-        lierre_thread_create(&threads[i], minimize_thread, &contexts[i]);
-    }
-
-    for (i = 0; i < num_threads; i++) {
-        lierre_thread_join(threads[i], NULL);
-    }
-
-    lfree(threads);
-    lfree(contexts);
+    executor_run(executor, minimize_task, &ctx, ctx.num_tasks);
 
     *out_width = new_width;
     *out_height = new_height;
@@ -515,7 +504,7 @@ static inline uint8_t *apply_minimize_once_mt(const uint8_t *image, size_t width
 }
 
 static inline uint8_t *lierre_image_minimize(const uint8_t *image, size_t width, size_t height, size_t *out_width,
-                                             size_t *out_height, bool use_mt, uint32_t num_threads)
+                                             size_t *out_height, const executor_t *executor)
 {
     uint32_t iter;
     uint8_t *current, *next;
@@ -531,8 +520,8 @@ static inline uint8_t *lierre_image_minimize(const uint8_t *image, size_t width,
     cur_height = height;
 
     for (iter = 0; iter < LIERRE_IMAGE_MINIMIZE_MAX_ITERATIONS; iter++) {
-        if (use_mt) {
-            next = apply_minimize_once_mt(current, cur_width, cur_height, &new_width, &new_height, num_threads);
+        if (executor) {
+            next = apply_minimize_once_mt(current, cur_width, cur_height, &new_width, &new_height, executor);
         } else {
             next = apply_minimize_once(current, cur_width, cur_height, &new_width, &new_height);
         }
@@ -553,15 +542,16 @@ static inline uint8_t *lierre_image_minimize(const uint8_t *image, size_t width,
     return current;
 }
 
-static inline void *denoise_filter_thread(void *arg)
+static void denoise_filter_task(void *arg, uint32_t index)
 {
     lierre_image_mt_filter_ctx_t *ctx;
     int32_t sum;
-    size_t x, y, i, j, idx;
+    size_t x, y, i, j, idx, start_row, end_row;
 
     ctx = (lierre_image_mt_filter_ctx_t *)arg;
+    task_row_range(ctx->height, ctx->num_tasks, index, &start_row, &end_row);
 
-    for (y = ctx->start_row; y < ctx->end_row; y++) {
+    for (y = start_row; y < end_row; y++) {
         if (y == 0 || y >= ctx->height - 1) {
             continue;
         }
@@ -576,19 +566,18 @@ static inline void *denoise_filter_thread(void *arg)
             ctx->image[idx] = (uint8_t)(sum / LIERRE_FILTER_KERNEL_ELEMS);
         }
     }
-
-    return NULL;
 }
 
-static inline void *sharpening_filter_thread(void *arg)
+static void sharpening_filter_task(void *arg, uint32_t index)
 {
     lierre_image_mt_filter_ctx_t *ctx;
     int32_t val;
-    size_t x, y, idx;
+    size_t x, y, idx, start_row, end_row;
 
     ctx = (lierre_image_mt_filter_ctx_t *)arg;
+    task_row_range(ctx->height, ctx->num_tasks, index, &start_row, &end_row);
 
-    for (y = ctx->start_row; y < ctx->end_row; y++) {
+    for (y = start_row; y < end_row; y++) {
         if (y == 0 || y >= ctx->height - 1) {
             continue;
         }
@@ -606,8 +595,6 @@ static inline void *sharpening_filter_thread(void *arg)
             ctx->image[idx] = (uint8_t)val;
         }
     }
-
-    return NULL;
 }
 
 extern void image_brightness_normalize(uint8_t *image, size_t width, size_t height)
@@ -665,80 +652,34 @@ extern void image_contrast_normalize(uint8_t *image, size_t width, size_t height
     }
 }
 
-extern void image_denoise_mt(uint8_t *image, size_t width, size_t height, uint32_t num_threads)
+extern void image_denoise_mt(uint8_t *image, uint8_t *temp, size_t width, size_t height, const executor_t *executor)
 {
-    lierre_thread_t *threads;
-    lierre_image_mt_filter_ctx_t *contexts;
-    uint32_t i;
-    uint8_t *temp;
-    size_t rows_per_thread;
+    lierre_image_mt_filter_ctx_t ctx;
 
     if (width < 3 || height < 3) {
         return;
     }
 
-    if (num_threads > LIERRE_IMAGE_MT_MAX_THREADS) {
-        num_threads = LIERRE_IMAGE_MT_MAX_THREADS;
-    }
-    if (num_threads > height) {
-        num_threads = (uint32_t)height;
-    }
-    if (num_threads < 1) {
-        num_threads = 1;
-    }
-
-    temp = lmalloc(width * height);
-    if (!temp) {
-        return;
-    }
-
-    threads = lmalloc(sizeof(lierre_thread_t) * num_threads);
-    contexts = lmalloc(sizeof(lierre_image_mt_filter_ctx_t) * num_threads);
-    if (!threads || !contexts) {
-        lfree(temp);
-        lfree(threads);
-        lfree(contexts);
-        return;
-    }
-
     lmemcpy(temp, image, width * height);
 
-    rows_per_thread = height / num_threads;
+    ctx.image = image;
+    ctx.temp = temp;
+    ctx.width = width;
+    ctx.height = height;
+    ctx.num_tasks = task_count(executor, height);
 
-    for (i = 0; i < num_threads; i++) {
-        contexts[i].image = image;
-        contexts[i].temp = temp;
-        contexts[i].width = width;
-        contexts[i].height = height;
-        contexts[i].start_row = i * rows_per_thread;
-        contexts[i].end_row = (i == num_threads - 1) ? height : (i + 1) * rows_per_thread;
-        lierre_thread_create(&threads[i], denoise_filter_thread, &contexts[i]);
-    }
-
-    for (i = 0; i < num_threads; i++) {
-        lierre_thread_join(threads[i], NULL);
-    }
-
-    lfree(threads);
-    lfree(contexts);
-    lfree(temp);
+    executor_run(executor, denoise_filter_task, &ctx, ctx.num_tasks);
 }
 
-extern void image_denoise(uint8_t *image, size_t width, size_t height)
+extern void image_denoise(uint8_t *image, uint8_t *temp, size_t width, size_t height)
 {
     int32_t sum;
-    uint8_t *temp;
     size_t x, y, i, j, idx;
 
     if (width < 3 || height < 3) {
         return;
     }
 
-    temp = lmalloc(width * height);
-    if (!temp) {
-        return;
-    }
-
     lmemcpy(temp, image, width * height);
 
     for (y = 1; y < height - 1; y++) {
@@ -753,84 +694,36 @@ extern void image_denoise(uint8_t *image, size_t width, size_t height)
             image[idx] = (uint8_t)(sum / LIERRE_FILTER_KERNEL_ELEMS);
         }
     }
-
-    lfree(temp);
 }
 
-extern void image_sharpen_mt(uint8_t *image, size_t width, size_t height, uint32_t num_threads)
+extern void image_sharpen_mt(uint8_t *image, uint8_t *temp, size_t width, size_t height, const executor_t *executor)
 {
-    lierre_thread_t *threads;
-    lierre_image_mt_filter_ctx_t *contexts;
-    uint32_t i;
-    uint8_t *temp;
-    size_t rows_per_thread;
+    lierre_image_mt_filter_ctx_t ctx;
 
     if (width < 3 || height < 3) {
         return;
     }
 
-    if (num_threads > LIERRE_IMAGE_MT_MAX_THREADS) {
-        num_threads = LIERRE_IMAGE_MT_MAX_THREADS;
-    }
-    if (num_threads > height) {
-        num_threads = (uint32_t)height;
-    }
-    if (num_threads < 1) {
-        num_threads = 1;
-    }
-
-    temp = lmalloc(width * height);
-    if (!temp) {
-        return;
-    }
-
-    threads = lmalloc(sizeof(lierre_thread_t) * num_threads);
-    contexts = lmalloc(sizeof(lierre_image_mt_filter_ctx_t) * num_threads);
-    if (!threads || !contexts) {
-        lfree(temp);
-        lfree(threads);
-        lfree(contexts);
-        return;
-    }
-
     lmemcpy(temp, image, width * height);
 
-    rows_per_thread = height / num_threads;
-
-    for (i = 0; i < num_threads; i++) {
-        contexts[i].image = image;
-        contexts[i].temp = temp;
-        contexts[i].width = width;
-        contexts[i].height = height;
-        contexts[i].start_row = i * rows_per_thread;
-        contexts[i].end_row = (i == num_threads - 1) ? height : (i + 1) * rows_per_thread;
-        lierre_thread_create(&threads[i], sharpening_filter_thread, &contexts[i]);
-    }
-
-    for (i = 0; i < num_threads; i++) {
-        lierre_thread_join(threads[i], NULL);
-    }
+    ctx.image = image;
+    ctx.temp = temp;
+    ctx.width = width;
+    ctx.height = height;
+    ctx.num_tasks = task_count(executor, height);
 
-    lfree(threads);
-    lfree(contexts);
-    lfree(temp);
+    executor_run(executor, sharpening_filter_task, &ctx, ctx.num_tasks);
 }
 
-extern void image_sharpen(uint8_t *image, size_t width, size_t height)
+extern void image_sharpen(uint8_t *image, uint8_t *temp, size_t width, size_t height)
 {
     int32_t val;
-    uint8_t *temp;
     size_t x, y, idx;
 
     if (width < 3 || height < 3) {
         return;
     }
 
-    temp = lmalloc(width * height);
-    if (!temp) {
-        return;
-    }
-
     lmemcpy(temp, image, width * height);
 
     for (y = 1; y < height - 1; y++) {
@@ -848,6 +741,4 @@ extern void image_sharpen(uint8_t *image, size_t width, size_t height)
             image[idx] = (uint8_t)val;
         }
     }
-
-    lfree(temp);
 }
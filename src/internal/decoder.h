@@ -23,26 +23,24 @@
 
 #include <poporon.h>
 
+#include "executor.h"
 #include "memory.h"
 
-#define LIERRE_DECODER_MAX_REGIONS        1024
-#define LIERRE_DECODER_MAX_CAPSTONES      32
-#define LIERRE_DECODER_MAX_GRIDS          (LIERRE_DECODER_MAX_CAPSTONES * 2)
+#define LIERRE_DECODER_REGION_EXTREMES    16
+#define LIERRE_DECODER_ARRAY_MIN_CAPACITY 16
 #define LIERRE_DECODER_PERSPECTIVE_PARAMS 8
+#define LIERRE_DECODER_REFINE_STEPS       80
 #define LIERRE_DECODER_MAX_PAYLOAD        8896
 
-#define LIERRE_DECODER_MT_MAX_THREADS 64
-
 #define LIERRE_DECODER_MAX_VERSION   40
 #define LIERRE_DECODER_MAX_GRID_SIZE (LIERRE_DECODER_MAX_VERSION * 4 + 17)
 #define LIERRE_DECODER_MAX_BITMAP    (((LIERRE_DECODER_MAX_GRID_SIZE * LIERRE_DECODER_MAX_GRID_SIZE) + 7) / 8)
 #define LIERRE_DECODER_MAX_ALIGNMENT 8
 
-#define LIERRE_PIXEL_WHITE  0
-#define LIERRE_PIXEL_BLACK  1
-#define LIERRE_PIXEL_REGION 2
+#define LIERRE_PIXEL_WHITE 0
+#define LIERRE_PIXEL_BLACK 1
 
-typedef uint16_t lierre_pixel_t;
+typedef uint8_t lierre_pixel_t;
 
 typedef struct {
     int32_t x;
@@ -53,6 +51,7 @@ typedef struct {
     decoder_point_t seed;
     int32_t count;
     int32_t capstone;
+    uint32_t component;
 } region_t;
 
 typedef struct {
@@ -61,6 +60,7 @@ typedef struct {
     decoder_point_t corners[4];
     decoder_point_t center;
     double c[LIERRE_DECODER_PERSPECTIVE_PARAMS];
+    double module_size;
     int32_t qr_grid;
 } capstone_t;
 
@@ -71,29 +71,112 @@ typedef struct {
     decoder_point_t tpep[3];
     int32_t grid_size;
     double c[LIERRE_DECODER_PERSPECTIVE_PARAMS];
+    int32_t fitness;
+    uint32_t refine_budget;
+    uint32_t refine_steps;
+    bool refine_limited;
+    bool decoded;
 } grid_t;
 
 typedef struct {
-    int32_t y;
+    double *u;
+    double *v;
+    int32_t *weights;
+    size_t count;
+} grid_lattice_t;
+
+typedef struct {
+    int32_t left;
     int32_t right;
-    int32_t left_up;
-    int32_t left_down;
-} flood_fill_vars_t;
+    uint32_t parent;
+} pixel_run_t;
+
+typedef struct {
+    decoder_point_t extremes[LIERRE_DECODER_REGION_EXTREMES];
+} region_stats_t;
+
+typedef struct {
+    int32_t count;
+    int32_t region;
+    int32_t y;
+    uint32_t stats;
+} region_component_t;
+
+typedef struct {
+    uint32_t x;
+    uint32_t y;
+    uint32_t pattern_widths[5];
+} finder_candidate_t;
+
+typedef struct {
+    finder_candidate_t *candidates;
+    size_t num_candidates;
+    size_t capacity;
+    pixel_run_t *runs;
+    size_t num_runs;
+    size_t runs_capacity;
+    size_t run_offset;
+    uint32_t row_begin;
+    uint32_t row_end;
+    uint32_t num_rejected;
+    bool failed;
+} decoder_stripe_t;
 
 typedef struct {
-    uint8_t *image;
+    uint32_t *cell_start;
+    size_t cell_capacity;
+    int32_t *items;
+    size_t items_capacity;
+    int32_t *nearby;
+    size_t nearby_capacity;
+    int32_t cols;
+    int32_t rows;
+    double cell_size;
+} capstone_index_t;
+
+typedef struct {
+    const uint8_t *image;
     lierre_pixel_t *pixels;
+    size_t capacity;
     int32_t w;
     int32_t h;
     uint8_t threshold;
     int32_t num_regions;
-    region_t regions[LIERRE_DECODER_MAX_REGIONS];
+    region_t *regions;
+    size_t regions_capacity;
     int32_t num_capstones;
-    capstone_t capstones[LIERRE_DECODER_MAX_CAPSTONES];
+    capstone_t *capstones;
+    size_t capstones_capacity;
+    struct _capstone_neighbour_t *neighbours;
+    size_t neighbours_capacity;
+    capstone_index_t capstone_index;
     int32_t num_grids;
-    grid_t grids[LIERRE_DECODER_MAX_GRIDS];
-    size_t num_flood_fill_vars;
-    flood_fill_vars_t *flood_fill_vars;
+    grid_t *grids;
+    size_t grids_capacity;
+    int32_t *grid_order;
+    size_t grid_order_capacity;
+    grid_lattice_t lattices[LIERRE_DECODER_MAX_VERSION + 1];
+    pixel_run_t *runs;
+    size_t num_runs;
+    size_t runs_capacity;
+    uint32_t *row_runs;
+    size_t row_runs_capacity;
+    region_component_t *components;
+    size_t components_capacity;
+    region_stats_t *stats;
+    size_t stats_capacity;
+    decoder_stripe_t *stripes;
+    uint32_t num_stripes;
+    uint32_t stripes_capacity;
+    uint32_t num_finder_candidates;
+    uint32_t num_finder_rejected;
+    lierre_reader_limits_t limits;
+    bool lazy_refine;
+    lierre_reader_limit_flag_t limits_hit;
+    struct _decode_thread_ctx_t *thread_contexts;
+    size_t thread_contexts_capacity;
+    uint32_t num_thread_contexts;
+    uint32_t num_grid_tasks;
 } decoder_t;
 
 typedef struct {
@@ -104,7 +187,11 @@ typedef struct {
 
 typedef struct {
     uint32_t count;
-    decoder_code_t codes[LIERRE_DECODER_MAX_GRIDS];
+    uint32_t num_finder_candidates;
+    uint32_t num_finder_rejected;
+    lierre_reader_limit_flag_t limits_hit;
+    decoder_code_t *codes;
+    size_t capacity;
 } decoder_result_t;
 
 typedef struct {
@@ -142,7 +229,7 @@ typedef struct {
     uint8_t data[LIERRE_DECODER_MAX_PAYLOAD];
 } datastream_t;
 
-typedef struct {
+typedef struct _decode_thread_ctx_t {
     decoder_t *decoder;
     int32_t grid_index;
     qr_code_t code;
@@ -156,38 +243,78 @@ typedef struct {
     decoder_point_t *corners;
 } corner_finder_data_t;
 
-typedef struct {
+typedef struct _capstone_neighbour_t {
     int32_t index;
     double distance;
 } capstone_neighbour_t;
 
 typedef struct {
-    capstone_neighbour_t entries[LIERRE_DECODER_MAX_CAPSTONES];
+    capstone_neighbour_t *entries;
     int32_t count;
 } capstone_neighbour_list_t;
 
-typedef void (*span_callback_t)(void *user_data, int32_t y, int32_t left, int32_t right);
+typedef void (*point_callback_t)(void *user_data, int32_t x, int32_t y);
+
+/*
+ * Makes room for count elements of size bytes, doubling from the current capacity. Returns the array to use from now
+ * on, or NULL with the old array and capacity untouched when the allocation fails.
+ */
+static inline void *decoder_array_reserve(void *array, size_t *capacity, size_t count, size_t size)
+{
+    void *grown;
+    size_t new_capacity;
+
+    if (count <= *capacity) {
+        return array;
+    }
+
+    new_capacity = *capacity ? *capacity : LIERRE_DECODER_ARRAY_MIN_CAPACITY;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+
+    grown = lmalloc(new_capacity * size);
+    if (!grown) {
+        return NULL;
+    }
+
+    if (array) {
+        lmemcpy(grown, array, *capacity * size);
+        lfree(array);
+    }
+
+    *capacity = new_capacity;
+
+    return grown;
+}
 
 extern const version_info_t lierre_version_db[LIERRE_DECODER_MAX_VERSION + 1];
 
 decoder_t *lierre_decoder_create(void);
 void lierre_decoder_destroy(decoder_t *decoder);
+decoder_result_t *lierre_decoder_result_create(void);
+void lierre_decoder_result_destroy(decoder_result_t *result);
 lierre_error_t lierre_decoder_process(decoder_t *decoder, const uint8_t *gray_image, int32_t width, int32_t height,
                                       decoder_result_t *result);
 lierre_error_t lierre_decoder_process_mt(decoder_t *decoder, const uint8_t *gray_image, int32_t width, int32_t height,
-                                         decoder_result_t *result, uint32_t num_threads);
+                                         decoder_result_t *result, const executor_t *executor);
 
-void flood_fill_seed(decoder_t *decoder, int32_t seed_x, int32_t seed_y, lierre_pixel_t source_color,
-                     lierre_pixel_t target_color, span_callback_t callback, void *user_data);
+bool label_binarize_row(decoder_t *decoder, decoder_stripe_t *stripe, uint32_t y);
+lierre_error_t label_merge_stripes(decoder_t *decoder, const executor_t *executor);
+int32_t label_component_at(const decoder_t *decoder, int32_t x, int32_t y);
+void region_for_each_extreme(const decoder_t *decoder, int32_t region_id, point_callback_t callback, void *user_data);
 int32_t get_or_create_region(decoder_t *decoder, int32_t x, int32_t y);
 void find_region_corners(decoder_t *decoder, int32_t region_id, const decoder_point_t *reference,
                          decoder_point_t *corners);
-void scan_finder_patterns(decoder_t *decoder, uint32_t y);
-void find_capstone_groups(decoder_t *decoder, int32_t capstone_index);
+lierre_error_t detect_capstones(decoder_t *decoder, const executor_t *executor);
+void find_capstone_groups(decoder_t *decoder);
 
 void perspective_map(const double *coeffs, double u, double v, decoder_point_t *result);
 void perspective_setup(double *coeffs, const decoder_point_t *corners, double width, double height);
 void perspective_unmap(const double *coeffs, const decoder_point_t *image_point, double *grid_u, double *grid_v);
+bool order_qr_grids(decoder_t *decoder);
+bool qr_grid_is_duplicate(const decoder_t *decoder, int32_t grid_index);
+void refine_qr_grid(decoder_t *decoder, int32_t grid_index);
 void extract_qr_code(const decoder_t *decoder, int32_t grid_index, qr_code_t *code);
 void test_neighbour_pairs(decoder_t *decoder, int32_t capstone_index, const capstone_neighbour_list_t *horizontal_list,
                           const capstone_neighbour_list_t *vertical_list);
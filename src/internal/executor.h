@@ -0,0 +1,53 @@
+/*
+ * liblierre - executor.h
+ *
+ * This file is part of liblierre.
+ *
+ * Author: Go Kudo <zeriyoshi@gmail.com>
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIERRE_INTERNAL_EXECUTOR_H
+#define LIERRE_INTERNAL_EXECUTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <lierre/reader.h>
+
+typedef struct {
+    lierre_reader_executor_t run;
+    void *ctx;
+    uint32_t parallelism;
+} executor_t;
+
+static inline uint32_t executor_task_count(const executor_t *executor, size_t num_items)
+{
+    uint32_t num_tasks;
+
+    num_tasks = executor ? executor->parallelism : 1;
+    if (num_tasks > num_items) {
+        num_tasks = (uint32_t)num_items;
+    }
+    if (num_tasks < 1) {
+        num_tasks = 1;
+    }
+
+    return num_tasks;
+}
+
+static inline void executor_run(const executor_t *executor, lierre_reader_task_t task, void *arg, uint32_t num_tasks)
+{
+    uint32_t index;
+
+    if (!executor || !executor->run || num_tasks <= 1) {
+        for (index = 0; index < num_tasks; index++) {
+            task(arg, index);
+        }
+        return;
+    }
+
+    executor->run(executor->ctx, task, arg, num_tasks);
+}
+
+#endif /* LIERRE_INTERNAL_EXECUTOR_H */
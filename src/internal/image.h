@@ -16,11 +16,13 @@
 
 #include <lierre/portable.h>
 
+#include "executor.h"
+
 void image_brightness_normalize(uint8_t *image, size_t width, size_t height);
 void image_contrast_normalize(uint8_t *image, size_t width, size_t height);
-void image_denoise_mt(uint8_t *image, size_t width, size_t height, uint32_t num_threads);
-void image_denoise(uint8_t *image, size_t width, size_t height);
-void image_sharpen_mt(uint8_t *image, size_t width, size_t height, uint32_t num_threads);
-void image_sharpen(uint8_t *image, size_t width, size_t height);
+void image_denoise_mt(uint8_t *image, uint8_t *temp, size_t width, size_t height, const executor_t *executor);
+void image_denoise(uint8_t *image, uint8_t *temp, size_t width, size_t height);
+void image_sharpen_mt(uint8_t *image, uint8_t *temp, size_t width, size_t height, const executor_t *executor);
+void image_sharpen(uint8_t *image, uint8_t *temp, size_t width, size_t height);
 
 #endif /* LIERRE_INTERNAL_IMAGE_H */
@@ -28,4 +28,34 @@
 #include <wasm_simd128.h>
 #endif
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+static inline uint32_t simd_ctz32(uint32_t value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+
+    _BitScanForward(&index, value);
+
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctz(value);
+#endif
+}
+
+static inline uint32_t simd_ctz64(uint64_t value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    if ((uint32_t)value) {
+        return simd_ctz32((uint32_t)value);
+    }
+
+    return 32 + simd_ctz32((uint32_t)(value >> 32));
+#else
+    return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
 #endif /* LIERRE_INTERNAL_SIMD_H */
@@ -18,9 +18,24 @@
 #include <lierre/reader.h>
 #include <lierre/writer.h>
 
+#include "decoder.h"
+
+typedef struct {
+    decoder_t *decoder;
+    decoder_result_t *result;
+    uint8_t *gray;
+    size_t gray_capacity;
+    uint8_t *scratch;
+    size_t scratch_capacity;
+} reader_workspace_t;
+
 struct _lierre_reader_t {
     lierre_rgb_data_t *data;
     lierre_reader_param_t *param;
+    lierre_thread_pool_t *pool;
+    reader_workspace_t workspace;
+    reader_workspace_t *batch_workspaces;
+    size_t num_batch_workspaces;
 };
 
 struct _lierre_reader_result_t {
@@ -28,6 +43,9 @@ struct _lierre_reader_result_t {
     lierre_rect_t *qr_code_rects;
     uint8_t **qr_code_datas;
     size_t *qr_code_data_sizes;
+    uint32_t num_finder_candidates;
+    uint32_t num_finder_rejected;
+    lierre_reader_limit_flag_t limits_hit;
 };
 
 struct _lierre_writer_t {
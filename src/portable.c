@@ -83,6 +83,140 @@ extern int lierre_thread_join(lierre_thread_t thread, void **retval)
     return 0;
 }
 
+typedef struct {
+    void (*init_routine)(void);
+} win32_once_ctx_t;
+
+static inline BOOL CALLBACK win32_once_wrapper(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    win32_once_ctx_t *ctx = (win32_once_ctx_t *)param;
+
+    (void)once;
+    (void)context;
+
+    ctx->init_routine();
+
+    return TRUE;
+}
+
+extern int lierre_mutex_init(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return EINVAL;
+    }
+
+    InitializeCriticalSection(mutex);
+    return 0;
+}
+
+extern void lierre_mutex_destroy(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return;
+    }
+
+    DeleteCriticalSection(mutex);
+}
+
+extern int lierre_mutex_lock(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return EINVAL;
+    }
+
+    EnterCriticalSection(mutex);
+    return 0;
+}
+
+extern int lierre_mutex_unlock(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return EINVAL;
+    }
+
+    LeaveCriticalSection(mutex);
+    return 0;
+}
+
+extern int lierre_cond_init(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return EINVAL;
+    }
+
+    InitializeConditionVariable(cond);
+    return 0;
+}
+
+extern void lierre_cond_destroy(lierre_cond_t *cond)
+{
+    (void)cond;
+}
+
+extern int lierre_cond_wait(lierre_cond_t *cond, lierre_mutex_t *mutex)
+{
+    if (!cond || !mutex) {
+        return EINVAL;
+    }
+
+    if (!SleepConditionVariableCS(cond, mutex, INFINITE)) {
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+extern int lierre_cond_signal(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return EINVAL;
+    }
+
+    WakeConditionVariable(cond);
+    return 0;
+}
+
+extern int lierre_cond_broadcast(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return EINVAL;
+    }
+
+    WakeAllConditionVariable(cond);
+    return 0;
+}
+
+extern int lierre_once(lierre_once_t *once, void (*init_routine)(void))
+{
+    win32_once_ctx_t ctx;
+
+    if (!once || !init_routine) {
+        return EINVAL;
+    }
+
+    ctx.init_routine = init_routine;
+    if (!InitOnceExecuteOnce(once, win32_once_wrapper, &ctx, NULL)) {
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+extern uint32_t lierre_atomic_load(volatile uint32_t *value)
+{
+    return (uint32_t)InterlockedCompareExchange((volatile LONG *)value, 0, 0);
+}
+
+extern void lierre_atomic_store(volatile uint32_t *value, uint32_t desired)
+{
+    InterlockedExchange((volatile LONG *)value, (LONG)desired);
+}
+
+extern uint32_t lierre_atomic_fetch_add(volatile uint32_t *value, uint32_t delta)
+{
+    return (uint32_t)InterlockedExchangeAdd((volatile LONG *)value, (LONG)delta);
+}
+
 extern uint32_t lierre_get_cpu_count(void)
 {
     SYSTEM_INFO sysinfo;
@@ -96,6 +230,8 @@ extern uint32_t lierre_get_cpu_count(void)
 
 #else
 
+#include <errno.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 extern int lierre_thread_create(lierre_thread_t *thread, void *(*start_routine)(void *), void *arg)
@@ -108,6 +244,111 @@ extern int lierre_thread_join(lierre_thread_t thread, void **retval)
     return pthread_join(thread, retval);
 }
 
+extern int lierre_mutex_init(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return EINVAL;
+    }
+
+    return pthread_mutex_init(mutex, NULL);
+}
+
+extern void lierre_mutex_destroy(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return;
+    }
+
+    pthread_mutex_destroy(mutex);
+}
+
+extern int lierre_mutex_lock(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return EINVAL;
+    }
+
+    return pthread_mutex_lock(mutex);
+}
+
+extern int lierre_mutex_unlock(lierre_mutex_t *mutex)
+{
+    if (!mutex) {
+        return EINVAL;
+    }
+
+    return pthread_mutex_unlock(mutex);
+}
+
+extern int lierre_cond_init(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return EINVAL;
+    }
+
+    return pthread_cond_init(cond, NULL);
+}
+
+extern void lierre_cond_destroy(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return;
+    }
+
+    pthread_cond_destroy(cond);
+}
+
+extern int lierre_cond_wait(lierre_cond_t *cond, lierre_mutex_t *mutex)
+{
+    if (!cond || !mutex) {
+        return EINVAL;
+    }
+
+    return pthread_cond_wait(cond, mutex);
+}
+
+extern int lierre_cond_signal(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return EINVAL;
+    }
+
+    return pthread_cond_signal(cond);
+}
+
+extern int lierre_cond_broadcast(lierre_cond_t *cond)
+{
+    if (!cond) {
+        return EINVAL;
+    }
+
+    return pthread_cond_broadcast(cond);
+}
+
+extern int lierre_once(lierre_once_t *once, void (*init_routine)(void))
+{
+    if (!once || !init_routine) {
+        return EINVAL;
+    }
+
+    return pthread_once(once, init_routine);
+}
+
+extern uint32_t lierre_atomic_load(volatile uint32_t *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+extern void lierre_atomic_store(volatile uint32_t *value, uint32_t desired)
+{
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+}
+
+extern uint32_t lierre_atomic_fetch_add(volatile uint32_t *value, uint32_t delta)
+{
+    return __atomic_fetch_add(value, delta, __ATOMIC_ACQ_REL);
+}
+
 extern uint32_t lierre_get_cpu_count(void)
 {
     long nprocs;
@@ -124,4 +365,226 @@ extern uint32_t lierre_get_cpu_count(void)
 
 #endif
 
+typedef struct _lierre_thread_pool_job_t {
+    lierre_thread_pool_task_t task;
+    void *arg;
+    uint32_t num_tasks;
+    volatile uint32_t next_task;
+    volatile uint32_t finished_tasks;
+    struct _lierre_thread_pool_job_t *next;
+} lierre_thread_pool_job_t;
+
+struct _lierre_thread_pool_t {
+    lierre_mutex_t lock;
+    lierre_cond_t work_cond;
+    lierre_cond_t done_cond;
+    lierre_thread_pool_job_t *head;
+    lierre_thread_pool_job_t *tail;
+    lierre_thread_t *workers;
+    uint32_t num_workers;
+    bool shutdown;
+};
+
+/* Must be called with the pool lock held. */
+static inline void thread_pool_unlink(lierre_thread_pool_t *pool, lierre_thread_pool_job_t *job)
+{
+    lierre_thread_pool_job_t *prev, *cur;
+
+    prev = NULL;
+    for (cur = pool->head; cur; prev = cur, cur = cur->next) {
+        if (cur == job) {
+            if (prev) {
+                prev->next = cur->next;
+            } else {
+                pool->head = cur->next;
+            }
+            if (pool->tail == cur) {
+                pool->tail = prev;
+            }
+            return;
+        }
+    }
+}
+
+/* The job lives on the stack of the submitting thread and may be gone as soon as the last task is counted. */
+static inline void thread_pool_finish_task(lierre_thread_pool_t *pool, lierre_thread_pool_job_t *job)
+{
+    uint32_t num_tasks;
+
+    num_tasks = job->num_tasks;
+    if (lierre_atomic_fetch_add(&job->finished_tasks, 1) + 1 == num_tasks) {
+        lierre_mutex_lock(&pool->lock);
+        lierre_cond_broadcast(&pool->done_cond);
+        lierre_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *thread_pool_worker(void *arg)
+{
+    lierre_thread_pool_t *pool;
+    lierre_thread_pool_job_t *job;
+    uint32_t index;
+
+    pool = (lierre_thread_pool_t *)arg;
+
+    lierre_mutex_lock(&pool->lock);
+
+    for (;;) {
+        while (!pool->shutdown && !pool->head) {
+            lierre_cond_wait(&pool->work_cond, &pool->lock);
+        }
+
+        if (!pool->head) {
+            break;
+        }
+
+        job = pool->head;
+        index = lierre_atomic_fetch_add(&job->next_task, 1);
+        if (index >= job->num_tasks) {
+            thread_pool_unlink(pool, job);
+            continue;
+        }
+
+        lierre_mutex_unlock(&pool->lock);
+
+        job->task(job->arg, index);
+        thread_pool_finish_task(pool, job);
+
+        lierre_mutex_lock(&pool->lock);
+    }
+
+    lierre_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+extern lierre_thread_pool_t *lierre_thread_pool_create(uint32_t num_threads)
+{
+    lierre_thread_pool_t *pool;
+    uint32_t i;
+
+    pool = (lierre_thread_pool_t *)calloc(1, sizeof(lierre_thread_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+
+    if (lierre_mutex_init(&pool->lock) != 0) {
+        free(pool);
+        return NULL;
+    }
+
+    if (lierre_cond_init(&pool->work_cond) != 0) {
+        lierre_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    if (lierre_cond_init(&pool->done_cond) != 0) {
+        lierre_cond_destroy(&pool->work_cond);
+        lierre_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    /* The thread calling lierre_thread_pool_run() always works on its own job, so it counts as one of the threads. */
+    if (num_threads > 1) {
+        pool->workers = (lierre_thread_t *)malloc(sizeof(lierre_thread_t) * (num_threads - 1));
+        if (!pool->workers) {
+            lierre_thread_pool_destroy(pool);
+            return NULL;
+        }
+
+        for (i = 0; i < num_threads - 1; i++) {
+            if (lierre_thread_create(&pool->workers[i], thread_pool_worker, pool) != 0) {
+                break;
+            }
+            pool->num_workers++;
+        }
+    }
+
+    return pool;
+}
+
+extern void lierre_thread_pool_destroy(lierre_thread_pool_t *pool)
+{
+    uint32_t i;
+
+    if (!pool) {
+        return;
+    }
+
+    lierre_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    lierre_cond_broadcast(&pool->work_cond);
+    lierre_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->num_workers; i++) {
+        lierre_thread_join(pool->workers[i], NULL);
+    }
+
+    lierre_cond_destroy(&pool->done_cond);
+    lierre_cond_destroy(&pool->work_cond);
+    lierre_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+extern uint32_t lierre_thread_pool_get_num_threads(const lierre_thread_pool_t *pool)
+{
+    if (!pool) {
+        return 1;
+    }
+
+    return pool->num_workers + 1;
+}
+
+extern int lierre_thread_pool_run(lierre_thread_pool_t *pool, lierre_thread_pool_task_t task, void *arg,
+                                  uint32_t num_tasks)
+{
+    lierre_thread_pool_job_t job;
+    uint32_t index;
+
+    if (!task) {
+        return EINVAL;
+    }
+
+    if (!pool || pool->num_workers == 0 || num_tasks <= 1) {
+        for (index = 0; index < num_tasks; index++) {
+            task(arg, index);
+        }
+        return 0;
+    }
+
+    job.task = task;
+    job.arg = arg;
+    job.num_tasks = num_tasks;
+    job.next_task = 0;
+    job.finished_tasks = 0;
+    job.next = NULL;
+
+    lierre_mutex_lock(&pool->lock);
+    if (pool->tail) {
+        pool->tail->next = &job;
+    } else {
+        pool->head = &job;
+    }
+    pool->tail = &job;
+    lierre_cond_broadcast(&pool->work_cond);
+    lierre_mutex_unlock(&pool->lock);
+
+    while ((index = lierre_atomic_fetch_add(&job.next_task, 1)) < num_tasks) {
+        task(arg, index);
+        thread_pool_finish_task(pool, &job);
+    }
+
+    lierre_mutex_lock(&pool->lock);
+    thread_pool_unlink(pool, &job);
+    while (lierre_atomic_load(&job.finished_tasks) < num_tasks) {
+        lierre_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    lierre_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
 /* LCOV_EXCL_STOP */
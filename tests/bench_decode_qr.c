@@ -0,0 +1,148 @@
+/*
+ * liblierre - bench_decode_qr.c
+ *
+ * This file is part of liblierre.
+ *
+ * Author: Go Kudo <zeriyoshi@gmail.com>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lierre.h>
+#include <lierre/writer.h>
+
+#include "internal/decoder.h"
+
+#define BENCH_DATA_SIZE    1200
+#define BENCH_ITERATIONS   2000
+#define BENCH_FLIP_COLUMNS 2
+#define BENCH_FLIP_ROWS    8
+
+static inline void grid_flip(qr_code_t *code, int32_t x, int32_t y)
+{
+    int32_t bit_position;
+
+    bit_position = y * code->size + x;
+    code->cell_bitmap[bit_position >> 3] ^= (uint8_t)(1 << (bit_position & 7));
+}
+
+static inline bool build_code(qr_code_t *code, lierre_writer_ecc_t ecc)
+{
+    lierre_writer_param_t param;
+    lierre_rgba_t fill = {0, 0, 0, 255}, bg = {255, 255, 255, 255};
+    lierre_writer_t *writer;
+    lierre_reso_t res;
+    const uint8_t *rgba;
+    uint8_t data[BENCH_DATA_SIZE];
+    int32_t x, y, bit_position;
+    size_t i;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    if (lierre_writer_param_init(&param, data, sizeof(data), 1, 0, ecc, MASK_AUTO, MODE_BYTE) !=
+            LIERRE_ERROR_SUCCESS ||
+        !lierre_writer_get_res(&param, &res)) {
+        return false;
+    }
+
+    writer = lierre_writer_create(&param, &fill, &bg);
+    if (!writer) {
+        return false;
+    }
+
+    if (lierre_writer_write(writer) != LIERRE_ERROR_SUCCESS) {
+        lierre_writer_destroy(writer);
+        return false;
+    }
+
+    memset(code, 0, sizeof(*code));
+    code->size = (int32_t)res.width;
+    rgba = lierre_writer_get_rgba_data(writer);
+
+    for (y = 0; y < code->size; y++) {
+        for (x = 0; x < code->size; x++) {
+            if (rgba[((size_t)y * res.width + (size_t)x) * 4] < 128) {
+                bit_position = y * code->size + x;
+                code->cell_bitmap[bit_position >> 3] |= (uint8_t)(1 << (bit_position & 7));
+            }
+        }
+    }
+
+    lierre_writer_destroy(writer);
+
+    return true;
+}
+
+static inline double bench_decode(const char *label, const qr_code_t *code)
+{
+    qr_data_t *data;
+    clock_t start;
+    double elapsed;
+    int32_t i;
+
+    data = (qr_data_t *)malloc(sizeof(*data));
+    if (!data) {
+        return -1.0;
+    }
+
+    if (decode_qr(code, data) != LIERRE_ERROR_SUCCESS || data->payload_len != BENCH_DATA_SIZE) {
+        fprintf(stderr, "%s: decode failed\n", label);
+        free(data);
+        return -1.0;
+    }
+
+    start = clock();
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        decode_qr(code, data);
+    }
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%-28s version %2d: %8.2f us/decode\n", label, data->version, elapsed * 1e6 / BENCH_ITERATIONS);
+
+    free(data);
+
+    return elapsed;
+}
+
+int main(void)
+{
+    static const lierre_writer_ecc_t levels[] = {ECC_LOW, ECC_HIGH};
+    static const char *const names[] = {"low", "high"};
+    qr_code_t clean, damaged;
+    char label[64];
+    int32_t x, y;
+    size_t i;
+
+    for (i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (!build_code(&clean, levels[i])) {
+            fprintf(stderr, "failed to build code\n");
+            return 1;
+        }
+
+        /* The bottom-right corner holds the first codewords of the leading blocks. */
+        memcpy(&damaged, &clean, sizeof(damaged));
+        for (y = 0; y < BENCH_FLIP_ROWS; y++) {
+            for (x = 0; x < BENCH_FLIP_COLUMNS; x++) {
+                grid_flip(&damaged, damaged.size - 1 - x, damaged.size - 1 - y);
+            }
+        }
+
+        snprintf(label, sizeof(label), "ecc %s clean", names[i]);
+        if (bench_decode(label, &clean) < 0.0) {
+            return 1;
+        }
+
+        snprintf(label, sizeof(label), "ecc %s damaged", names[i]);
+        if (bench_decode(label, &damaged) < 0.0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -998,6 +998,65 @@ static void test_encode_decode_all_versions_mt(void)
     TEST_ASSERT_EQUAL_INT_MESSAGE(0, failed_count, "Some versions failed in multi-thread mode");
 }
 
+static inline void encode_decode_with_mask(size_t data_size, lierre_writer_mask_t mask)
+{
+    const uint8_t *decoded_data;
+    lierre_writer_param_t writer_param;
+    lierre_writer_t *writer;
+    lierre_reader_param_t reader_param;
+    lierre_reader_t *reader;
+    lierre_reader_result_t *reader_result;
+    lierre_rgb_data_t *rgb_data;
+    lierre_reso_t res;
+    lierre_rgba_t fill_color = {0, 0, 0, 255}, bg_color = {255, 255, 255, 255};
+    uint8_t test_data[400];
+    size_t i;
+
+    TEST_ASSERT_TRUE(data_size <= sizeof(test_data));
+    for (i = 0; i < data_size; i++) {
+        test_data[i] = (uint8_t)(i * 31 + (size_t)mask);
+    }
+
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS,
+                      lierre_writer_param_init(&writer_param, test_data, data_size, 3, 2, ECC_LOW, mask, MODE_BYTE));
+    TEST_ASSERT_TRUE(lierre_writer_get_res(&writer_param, &res));
+
+    writer = lierre_writer_create(&writer_param, &fill_color, &bg_color);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_writer_write(writer));
+
+    rgb_data = convert_rgba_to_rgb(lierre_writer_get_rgba_data(writer), res.width, res.height);
+    TEST_ASSERT_NOT_NULL(rgb_data);
+
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_param_init(&reader_param));
+    reader = lierre_reader_create(&reader_param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(reader, rgb_data);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read(reader, &reader_result));
+    TEST_ASSERT_EQUAL_UINT32(1, lierre_reader_result_get_num_qr_codes(reader_result));
+
+    decoded_data = lierre_reader_result_get_qr_code_data(reader_result, 0);
+    TEST_ASSERT_NOT_NULL(decoded_data);
+    TEST_ASSERT_EQUAL(data_size, lierre_reader_result_get_qr_code_data_size(reader_result, 0));
+    TEST_ASSERT_EQUAL_MEMORY(test_data, decoded_data, data_size);
+
+    lierre_reader_result_destroy(reader_result);
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(rgb_data);
+    lierre_writer_destroy(writer);
+}
+
+static void test_encode_decode_all_masks(void)
+{
+    int mask;
+
+    for (mask = LIERRE_WRITER_MASK_0; mask <= LIERRE_WRITER_MASK_7; mask++) {
+        encode_decode_with_mask(64, (lierre_writer_mask_t)mask);
+        encode_decode_with_mask(400, (lierre_writer_mask_t)mask);
+    }
+}
+
 static void test_encode_decode_numeric_mode_simple(void)
 {
     const char *test_data = "0123456789";
@@ -1518,6 +1577,7 @@ int main(void)
 
     RUN_TEST(test_encode_decode_all_versions);
     RUN_TEST(test_encode_decode_all_versions_mt);
+    RUN_TEST(test_encode_decode_all_masks);
 
     RUN_TEST(test_encode_decode_numeric_mode_simple);
     RUN_TEST(test_encode_decode_numeric_mode_long);
@@ -81,6 +81,292 @@ void test_thread_join_basic(void)
     TEST_ASSERT_EQUAL(42, value);
 }
 
+typedef struct {
+    lierre_mutex_t mutex;
+    int counter;
+} mutex_test_ctx_t;
+
+static lierre_once_t once_flag = LIERRE_ONCE_INIT;
+static int once_counter = 0;
+
+static void once_routine(void)
+{
+    once_counter++;
+}
+
+static void *mutex_thread_func(void *arg)
+{
+    mutex_test_ctx_t *ctx = (mutex_test_ctx_t *)arg;
+    int i;
+
+    for (i = 0; i < 10000; i++) {
+        lierre_mutex_lock(&ctx->mutex);
+        ctx->counter++;
+        lierre_mutex_unlock(&ctx->mutex);
+    }
+
+    return NULL;
+}
+
+static void *once_thread_func(void *arg)
+{
+    (void)arg;
+
+    lierre_once(&once_flag, once_routine);
+
+    return NULL;
+}
+
+typedef struct {
+    lierre_mutex_t mutex;
+    lierre_cond_t cond;
+    int ready;
+} cond_test_ctx_t;
+
+static void *cond_thread_func(void *arg)
+{
+    cond_test_ctx_t *ctx = (cond_test_ctx_t *)arg;
+
+    lierre_mutex_lock(&ctx->mutex);
+    ctx->ready = 1;
+    lierre_cond_signal(&ctx->cond);
+    lierre_mutex_unlock(&ctx->mutex);
+
+    return NULL;
+}
+
+static void *atomic_thread_func(void *arg)
+{
+    volatile uint32_t *counter = (volatile uint32_t *)arg;
+    int i;
+
+    for (i = 0; i < 10000; i++) {
+        lierre_atomic_fetch_add(counter, 1);
+    }
+
+    return NULL;
+}
+
+#define POOL_TEST_TASKS 1000
+
+typedef struct {
+    lierre_thread_pool_t *pool;
+    volatile uint32_t hits[POOL_TEST_TASKS];
+    volatile uint32_t total;
+} pool_test_ctx_t;
+
+static void pool_task_func(void *arg, uint32_t index)
+{
+    pool_test_ctx_t *ctx = (pool_test_ctx_t *)arg;
+
+    lierre_atomic_fetch_add(&ctx->hits[index], 1);
+}
+
+static void pool_inner_task_func(void *arg, uint32_t index)
+{
+    pool_test_ctx_t *ctx = (pool_test_ctx_t *)arg;
+
+    (void)index;
+
+    lierre_atomic_fetch_add(&ctx->total, 1);
+}
+
+static void pool_nested_task_func(void *arg, uint32_t index)
+{
+    pool_test_ctx_t *ctx = (pool_test_ctx_t *)arg;
+
+    (void)index;
+
+    lierre_thread_pool_run(ctx->pool, pool_inner_task_func, ctx, 16);
+}
+
+void test_mutex_basic(void)
+{
+    lierre_mutex_t mutex;
+
+    TEST_ASSERT_EQUAL(0, lierre_mutex_init(&mutex));
+    TEST_ASSERT_EQUAL(0, lierre_mutex_lock(&mutex));
+    TEST_ASSERT_EQUAL(0, lierre_mutex_unlock(&mutex));
+    lierre_mutex_destroy(&mutex);
+}
+
+void test_mutex_null(void)
+{
+    TEST_ASSERT_NOT_EQUAL(0, lierre_mutex_init(NULL));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_mutex_lock(NULL));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_mutex_unlock(NULL));
+    lierre_mutex_destroy(NULL);
+}
+
+void test_mutex_multiple_threads(void)
+{
+    lierre_thread_t threads[4];
+    mutex_test_ctx_t ctx;
+    int i;
+
+    TEST_ASSERT_EQUAL(0, lierre_mutex_init(&ctx.mutex));
+    ctx.counter = 0;
+
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, lierre_thread_create(&threads[i], mutex_thread_func, &ctx));
+    }
+
+    for (i = 0; i < 4; i++) {
+        lierre_thread_join(threads[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL(40000, ctx.counter);
+    lierre_mutex_destroy(&ctx.mutex);
+}
+
+void test_once_multiple_threads(void)
+{
+    lierre_thread_t threads[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, lierre_thread_create(&threads[i], once_thread_func, NULL));
+    }
+
+    for (i = 0; i < 4; i++) {
+        lierre_thread_join(threads[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL(0, lierre_once(&once_flag, once_routine));
+    TEST_ASSERT_EQUAL(1, once_counter);
+}
+
+void test_once_null(void)
+{
+    TEST_ASSERT_NOT_EQUAL(0, lierre_once(NULL, once_routine));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_once(&once_flag, NULL));
+}
+
+void test_cond_basic(void)
+{
+    lierre_thread_t thread;
+    cond_test_ctx_t ctx;
+
+    TEST_ASSERT_EQUAL(0, lierre_mutex_init(&ctx.mutex));
+    TEST_ASSERT_EQUAL(0, lierre_cond_init(&ctx.cond));
+    ctx.ready = 0;
+
+    TEST_ASSERT_EQUAL(0, lierre_thread_create(&thread, cond_thread_func, &ctx));
+
+    lierre_mutex_lock(&ctx.mutex);
+    while (!ctx.ready) {
+        TEST_ASSERT_EQUAL(0, lierre_cond_wait(&ctx.cond, &ctx.mutex));
+    }
+    lierre_mutex_unlock(&ctx.mutex);
+
+    lierre_thread_join(thread, NULL);
+
+    TEST_ASSERT_EQUAL(0, lierre_cond_broadcast(&ctx.cond));
+    lierre_cond_destroy(&ctx.cond);
+    lierre_mutex_destroy(&ctx.mutex);
+}
+
+void test_cond_null(void)
+{
+    lierre_mutex_t mutex;
+
+    TEST_ASSERT_NOT_EQUAL(0, lierre_cond_init(NULL));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_cond_wait(NULL, &mutex));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_cond_signal(NULL));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_cond_broadcast(NULL));
+    lierre_cond_destroy(NULL);
+}
+
+void test_atomic_multiple_threads(void)
+{
+    lierre_thread_t threads[4];
+    volatile uint32_t counter;
+    int i;
+
+    lierre_atomic_store(&counter, 0);
+
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, lierre_thread_create(&threads[i], atomic_thread_func, (void *)&counter));
+    }
+
+    for (i = 0; i < 4; i++) {
+        lierre_thread_join(threads[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(40000, lierre_atomic_load(&counter));
+}
+
+void test_thread_pool_run(void)
+{
+    pool_test_ctx_t *ctx;
+    int i, round;
+
+    ctx = (pool_test_ctx_t *)calloc(1, sizeof(pool_test_ctx_t));
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    ctx->pool = lierre_thread_pool_create(4);
+    TEST_ASSERT_NOT_NULL(ctx->pool);
+    TEST_ASSERT_EQUAL_UINT32(4, lierre_thread_pool_get_num_threads(ctx->pool));
+
+    for (round = 0; round < 50; round++) {
+        TEST_ASSERT_EQUAL(0, lierre_thread_pool_run(ctx->pool, pool_task_func, ctx, POOL_TEST_TASKS));
+    }
+
+    for (i = 0; i < POOL_TEST_TASKS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(50, ctx->hits[i]);
+    }
+
+    lierre_thread_pool_destroy(ctx->pool);
+    free(ctx);
+}
+
+void test_thread_pool_run_nested(void)
+{
+    pool_test_ctx_t *ctx;
+
+    ctx = (pool_test_ctx_t *)calloc(1, sizeof(pool_test_ctx_t));
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    ctx->pool = lierre_thread_pool_create(3);
+    TEST_ASSERT_NOT_NULL(ctx->pool);
+
+    TEST_ASSERT_EQUAL(0, lierre_thread_pool_run(ctx->pool, pool_nested_task_func, ctx, 32));
+    TEST_ASSERT_EQUAL_UINT32(32 * 16, ctx->total);
+
+    lierre_thread_pool_destroy(ctx->pool);
+    free(ctx);
+}
+
+void test_thread_pool_single_thread(void)
+{
+    pool_test_ctx_t *ctx;
+    int i;
+
+    ctx = (pool_test_ctx_t *)calloc(1, sizeof(pool_test_ctx_t));
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    ctx->pool = lierre_thread_pool_create(1);
+    TEST_ASSERT_NOT_NULL(ctx->pool);
+    TEST_ASSERT_EQUAL_UINT32(1, lierre_thread_pool_get_num_threads(ctx->pool));
+
+    TEST_ASSERT_EQUAL(0, lierre_thread_pool_run(ctx->pool, pool_task_func, ctx, POOL_TEST_TASKS));
+    TEST_ASSERT_EQUAL(0, lierre_thread_pool_run(NULL, pool_task_func, ctx, POOL_TEST_TASKS));
+
+    for (i = 0; i < POOL_TEST_TASKS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(2, ctx->hits[i]);
+    }
+
+    lierre_thread_pool_destroy(ctx->pool);
+    free(ctx);
+}
+
+void test_thread_pool_null(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(1, lierre_thread_pool_get_num_threads(NULL));
+    TEST_ASSERT_NOT_EQUAL(0, lierre_thread_pool_run(NULL, NULL, NULL, 1));
+    lierre_thread_pool_destroy(NULL);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -91,5 +377,22 @@ int main(void)
 
     RUN_TEST(test_thread_join_basic);
 
+    RUN_TEST(test_mutex_basic);
+    RUN_TEST(test_mutex_null);
+    RUN_TEST(test_mutex_multiple_threads);
+
+    RUN_TEST(test_cond_basic);
+    RUN_TEST(test_cond_null);
+
+    RUN_TEST(test_once_multiple_threads);
+    RUN_TEST(test_once_null);
+
+    RUN_TEST(test_atomic_multiple_threads);
+
+    RUN_TEST(test_thread_pool_run);
+    RUN_TEST(test_thread_pool_run_nested);
+    RUN_TEST(test_thread_pool_single_thread);
+    RUN_TEST(test_thread_pool_null);
+
     return UNITY_END();
 }
@@ -7,6 +7,7 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -166,6 +167,13 @@ void test_reader_param_init_basic(void)
     TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
     TEST_ASSERT_EQUAL(LIERRE_READER_STRATEGY_NONE, param.strategy_flags);
     TEST_ASSERT_NULL(param.rect);
+    TEST_ASSERT_NULL(param.executor);
+    TEST_ASSERT_NULL(param.executor_ctx);
+    TEST_ASSERT_EQUAL_UINT32(0, param.max_parallelism);
+    TEST_ASSERT_EQUAL_UINT32(0, param.limits.max_region_area);
+    TEST_ASSERT_EQUAL_UINT32(0, param.limits.max_candidates);
+    TEST_ASSERT_EQUAL_UINT32(0, param.limits.max_grids);
+    TEST_ASSERT_EQUAL_UINT32(0, param.limits.max_refine_steps);
 }
 
 void test_reader_param_init_null(void)
@@ -220,6 +228,7 @@ void test_reader_param_set_flag_all(void)
     lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_CONTRAST_NORMALIZE);
     lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_SHARPENING);
     lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_MT);
+    lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_LAZY_REFINE);
 
     TEST_ASSERT_NOT_EQUAL(LIERRE_READER_STRATEGY_NONE, param.strategy_flags);
 }
@@ -252,6 +261,76 @@ void test_reader_param_set_rect_null_rect(void)
     TEST_ASSERT_NULL(param.rect);
 }
 
+typedef struct {
+    uint32_t calls;
+    uint32_t max_tasks;
+} test_executor_ctx_t;
+
+static void test_executor(void *executor_ctx, lierre_reader_task_t task, void *task_arg, uint32_t num_tasks)
+{
+    test_executor_ctx_t *ctx = (test_executor_ctx_t *)executor_ctx;
+    uint32_t i;
+
+    ctx->calls++;
+    if (num_tasks > ctx->max_tasks) {
+        ctx->max_tasks = num_tasks;
+    }
+
+    for (i = num_tasks; i > 0; i--) {
+        task(task_arg, i - 1);
+    }
+}
+
+void test_reader_param_set_executor_basic(void)
+{
+    lierre_reader_param_t param;
+    test_executor_ctx_t ctx;
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_executor(&param, test_executor, &ctx);
+    TEST_ASSERT_TRUE(param.executor == test_executor);
+    TEST_ASSERT_EQUAL_PTR(&ctx, param.executor_ctx);
+
+    lierre_reader_param_set_executor(&param, NULL, NULL);
+    TEST_ASSERT_NULL(param.executor);
+    TEST_ASSERT_NULL(param.executor_ctx);
+}
+
+void test_reader_param_set_executor_null(void)
+{
+    lierre_reader_param_set_executor(NULL, test_executor, NULL);
+    TEST_PASS();
+}
+
+void test_reader_param_set_max_parallelism(void)
+{
+    lierre_reader_param_t param;
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_max_parallelism(&param, 3);
+    TEST_ASSERT_EQUAL_UINT32(3, param.max_parallelism);
+
+    lierre_reader_param_set_max_parallelism(NULL, 3);
+}
+
+void test_reader_param_set_limits(void)
+{
+    lierre_reader_param_t param;
+    lierre_reader_limits_t limits = {1000, 20, 2, 50};
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_limits(&param, &limits);
+    TEST_ASSERT_EQUAL_UINT32(1000, param.limits.max_region_area);
+    TEST_ASSERT_EQUAL_UINT32(20, param.limits.max_candidates);
+    TEST_ASSERT_EQUAL_UINT32(2, param.limits.max_grids);
+    TEST_ASSERT_EQUAL_UINT32(50, param.limits.max_refine_steps);
+
+    lierre_reader_param_set_limits(&param, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1000, param.limits.max_region_area);
+
+    lierre_reader_param_set_limits(NULL, &limits);
+}
+
 void test_reader_create_basic(void)
 {
     lierre_reader_param_t param;
@@ -519,6 +598,13 @@ void test_reader_result_get_qr_code_data_size_null(void)
     TEST_ASSERT_EQUAL(0, size);
 }
 
+void test_reader_result_get_num_finder_candidates_null(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, lierre_reader_result_get_num_finder_candidates(NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, lierre_reader_result_get_num_finder_rejected(NULL));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, lierre_reader_result_get_limits_hit(NULL));
+}
+
 void test_reader_with_simple_rgb_data(void)
 {
     lierre_rgb_data_t *rgb;
@@ -882,6 +968,584 @@ void test_reader_four_qr_read_all_without_rect(void)
     lierre_rgb_destroy(rgb);
 }
 
+void test_reader_reuse_across_reads(void)
+{
+    const char *texts[4] = {"REUSE_1", "REUSE_2", "REUSE_3", "REUSE_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb, *blank;
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_reader_result_t *result = NULL;
+    lierre_error_t err;
+    uint8_t blank_data[64 * 48 * 3];
+    int i;
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    memset(blank_data, 255, sizeof(blank_data));
+    blank = lierre_rgb_create(blank_data, sizeof(blank_data), 64, 48);
+    TEST_ASSERT_NOT_NULL(blank);
+
+    lierre_reader_param_init(&param);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    for (i = 0; i < 3; i++) {
+        lierre_reader_set_data(reader, rgb);
+        err = lierre_reader_read(reader, &result);
+        TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
+        TEST_ASSERT_EQUAL_UINT32(4, lierre_reader_result_get_num_qr_codes(result));
+        lierre_reader_result_destroy(result);
+
+        lierre_reader_set_data(reader, blank);
+        err = lierre_reader_read(reader, &result);
+        TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
+        TEST_ASSERT_EQUAL_UINT32(0, lierre_reader_result_get_num_qr_codes(result));
+        lierre_reader_result_destroy(result);
+    }
+
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(blank);
+    lierre_rgb_destroy(rgb);
+}
+
+void test_reader_rejects_vertical_stripes_early(void)
+{
+    static const uint32_t pattern[5] = {8, 8, 24, 8, 8};
+    const char *texts[4] = {"CROSS_1", "CROSS_2", "CROSS_3", "CROSS_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb;
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_reader_result_t *result = NULL;
+    lierre_error_t err;
+    uint8_t *rgb_data, value;
+    size_t width = 320, height = 160, x, y, offset;
+    uint32_t i, edge;
+
+    /* Columns shaped like a finder pattern match every row horizontally but are solid black vertically. */
+    rgb_data = (uint8_t *)malloc(width * height * 3);
+    TEST_ASSERT_NOT_NULL(rgb_data);
+    for (x = 0; x < width; x++) {
+        offset = x % 96;
+        value = 255;
+        for (i = 0, edge = 16; i < 5; edge += pattern[i], i++) {
+            if (offset >= edge && offset < edge + pattern[i]) {
+                value = (i % 2) ? 255 : 0;
+            }
+        }
+        for (y = 0; y < height; y++) {
+            memset(&rgb_data[(y * width + x) * 3], value, 3);
+        }
+    }
+
+    rgb = lierre_rgb_create(rgb_data, width * height * 3, width, height);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    lierre_reader_param_init(&param);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(reader, rgb);
+    err = lierre_reader_read(reader, &result);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
+    TEST_ASSERT_EQUAL_UINT32(0, lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_TRUE(lierre_reader_result_get_num_finder_candidates(result) >= height);
+    TEST_ASSERT_EQUAL_UINT32(lierre_reader_result_get_num_finder_candidates(result),
+                             lierre_reader_result_get_num_finder_rejected(result));
+    lierre_reader_result_destroy(result);
+    lierre_rgb_destroy(rgb);
+    free(rgb_data);
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    lierre_reader_set_data(reader, rgb);
+    err = lierre_reader_read(reader, &result);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
+    TEST_ASSERT_EQUAL_UINT32(4, lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_TRUE(lierre_reader_result_get_num_finder_candidates(result) >
+                     lierre_reader_result_get_num_finder_rejected(result));
+    lierre_reader_result_destroy(result);
+
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(rgb);
+}
+
+static inline uint32_t read_four_qr_with_limits(lierre_rgb_data_t *rgb, lierre_reader_strategy_flag_t flags,
+                                                const lierre_reader_limits_t *limits,
+                                                lierre_reader_limit_flag_t *limits_hit)
+{
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_reader_result_t *result = NULL;
+    uint32_t count;
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_flag(&param, flags);
+    lierre_reader_param_set_limits(&param, limits);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(reader, rgb);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read(reader, &result));
+    count = lierre_reader_result_get_num_qr_codes(result);
+    *limits_hit = lierre_reader_result_get_limits_hit(result);
+
+    lierre_reader_result_destroy(result);
+    lierre_reader_destroy(reader);
+
+    return count;
+}
+
+void test_reader_read_with_limits(void)
+{
+    const char *texts[4] = {"LIMIT_1", "LIMIT_2", "LIMIT_3", "LIMIT_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb;
+    lierre_reader_limits_t limits;
+    lierre_reader_limit_flag_t limits_hit;
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    memset(&limits, 0, sizeof(limits));
+    TEST_ASSERT_EQUAL_UINT32(4, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_NONE, &limits, &limits_hit));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, limits_hit);
+
+    limits.max_region_area = 16;
+    TEST_ASSERT_EQUAL_UINT32(0, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_NONE, &limits, &limits_hit));
+    TEST_ASSERT_TRUE(limits_hit & LIERRE_READER_LIMIT_REGION_AREA);
+
+    memset(&limits, 0, sizeof(limits));
+    limits.max_candidates = 1;
+    TEST_ASSERT_EQUAL_UINT32(0, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_NONE, &limits, &limits_hit));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_CANDIDATES, limits_hit);
+
+    memset(&limits, 0, sizeof(limits));
+    limits.max_grids = 1;
+    TEST_ASSERT_EQUAL_UINT32(1, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_NONE, &limits, &limits_hit));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_GRIDS, limits_hit);
+
+    memset(&limits, 0, sizeof(limits));
+    limits.max_refine_steps = 1;
+    read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_NONE, &limits, &limits_hit);
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_REFINEMENT, limits_hit);
+
+    /* Grid creation scores each grid once; only the 80 refinement steps per code count against the budget. */
+    limits.max_refine_steps = 4 * 80;
+    TEST_ASSERT_EQUAL_UINT32(4, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_NONE, &limits, &limits_hit));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, limits_hit);
+
+    lierre_rgb_destroy(rgb);
+}
+
+void test_reader_read_lazy_refine(void)
+{
+    const char *texts[4] = {"LAZY_1", "LAZY_2", "LAZY_3", "LAZY_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb;
+    lierre_reader_limits_t limits;
+    lierre_reader_limit_flag_t limits_hit;
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    /* Flat synthetic codes decode through the initial transform, so refinement never starts. */
+    memset(&limits, 0, sizeof(limits));
+    limits.max_refine_steps = 1;
+    TEST_ASSERT_EQUAL_UINT32(4, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_LAZY_REFINE, &limits,
+                                                         &limits_hit));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, limits_hit);
+
+    TEST_ASSERT_EQUAL_UINT32(
+        4, read_four_qr_with_limits(rgb, LIERRE_READER_STRATEGY_LAZY_REFINE | LIERRE_READER_STRATEGY_MT, &limits,
+                                    &limits_hit));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, limits_hit);
+
+    lierre_rgb_destroy(rgb);
+}
+
+#define DEDUP_SCALE  4
+#define DEDUP_MARGIN 18
+
+static inline void stamp_finder_pattern(uint8_t *rgb_data, size_t width, size_t module_x, size_t module_y)
+{
+    size_t x, y, mx, my;
+    uint8_t value;
+
+    for (y = 0; y < 7 * DEDUP_SCALE; y++) {
+        for (x = 0; x < 7 * DEDUP_SCALE; x++) {
+            mx = x / DEDUP_SCALE;
+            my = y / DEDUP_SCALE;
+            value = (mx == 0 || mx == 6 || my == 0 || my == 6 || (mx >= 2 && mx <= 4 && my >= 2 && my <= 4)) ? 0 : 255;
+            memset(&rgb_data[((module_y * DEDUP_SCALE + y) * width + module_x * DEDUP_SCALE + x) * 3], value, 3);
+        }
+    }
+}
+
+/*
+ * One symbol plus four loose finder patterns in its quiet zone. The one above the top-left finder forms extra triples
+ * that share the symbol's capstones, and the three around the corners form a triple whose centre lies on the symbol.
+ */
+static inline lierre_rgb_data_t *generate_overlapping_triples_image(const char *text)
+{
+    lierre_writer_param_t param;
+    lierre_rgba_t fill = {0, 0, 0, 255}, bg = {255, 255, 255, 255};
+    lierre_reso_t res;
+    lierre_writer_t *writer;
+    lierre_rgb_data_t *rgb;
+    const uint8_t *rgba;
+    uint8_t *rgb_data;
+    size_t modules, i;
+
+    lierre_writer_param_init(&param, (uint8_t *)text, strlen(text), DEDUP_SCALE, DEDUP_MARGIN, ECC_MEDIUM, MASK_AUTO,
+                             MODE_BYTE);
+    if (!lierre_writer_get_res(&param, &res)) {
+        return NULL;
+    }
+
+    writer = lierre_writer_create(&param, &fill, &bg);
+    if (!writer || lierre_writer_write(writer) != LIERRE_ERROR_SUCCESS) {
+        lierre_writer_destroy(writer);
+        return NULL;
+    }
+
+    rgb_data = (uint8_t *)malloc(res.width * res.height * 3);
+    if (!rgb_data) {
+        lierre_writer_destroy(writer);
+        return NULL;
+    }
+
+    rgba = lierre_writer_get_rgba_data(writer);
+    for (i = 0; i < res.width * res.height; i++) {
+        rgb_data[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb_data[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb_data[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+    lierre_writer_destroy(writer);
+
+    modules = res.width / DEDUP_SCALE - DEDUP_MARGIN * 2;
+    stamp_finder_pattern(rgb_data, res.width, DEDUP_MARGIN, DEDUP_MARGIN - 14);
+    stamp_finder_pattern(rgb_data, res.width, DEDUP_MARGIN - 10, DEDUP_MARGIN - 10);
+    stamp_finder_pattern(rgb_data, res.width, DEDUP_MARGIN + modules + 3, DEDUP_MARGIN - 10);
+    stamp_finder_pattern(rgb_data, res.width, DEDUP_MARGIN - 10, DEDUP_MARGIN + modules + 3);
+
+    rgb = lierre_rgb_create(rgb_data, res.width * res.height * 3, res.width, res.height);
+    free(rgb_data);
+
+    return rgb;
+}
+
+static inline void read_overlapping_triples(lierre_rgb_data_t *rgb, const char *text,
+                                            const lierre_reader_param_t *param)
+{
+    lierre_reader_t *reader;
+    lierre_reader_result_t *result = NULL;
+
+    reader = lierre_reader_create(param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(reader, rgb);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read(reader, &result));
+    TEST_ASSERT_EQUAL_UINT32(1, lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_EQUAL_size_t(strlen(text), lierre_reader_result_get_qr_code_data_size(result, 0));
+    TEST_ASSERT_EQUAL_MEMORY(text, lierre_reader_result_get_qr_code_data(result, 0), strlen(text));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, lierre_reader_result_get_limits_hit(result));
+
+    lierre_reader_result_destroy(result);
+    lierre_reader_destroy(reader);
+}
+
+void test_reader_read_overlapping_triples(void)
+{
+    const char *text = "DEDUP";
+    lierre_rgb_data_t *rgb;
+    lierre_reader_param_t param;
+    lierre_reader_limits_t limits;
+    test_executor_ctx_t ctx = {0, 0};
+
+    rgb = generate_overlapping_triples_image(text);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    /* Serially the symbol decodes first, so its 80 refinement steps are the only ones spent on the whole frame. */
+    memset(&limits, 0, sizeof(limits));
+    limits.max_refine_steps = 80;
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_limits(&param, &limits);
+    read_overlapping_triples(rgb, text, &param);
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_MT);
+    read_overlapping_triples(rgb, text, &param);
+
+    /* A wave wide enough to hold every grid decodes them side by side before any duplicate check can run. */
+    lierre_reader_param_set_executor(&param, test_executor, &ctx);
+    lierre_reader_param_set_max_parallelism(&param, 8);
+    read_overlapping_triples(rgb, text, &param);
+    TEST_ASSERT_TRUE(ctx.max_tasks > 1);
+
+    lierre_rgb_destroy(rgb);
+}
+
+void test_reader_read_dense_sheet(void)
+{
+    lierre_writer_param_t wparam;
+    lierre_rgba_t fill = {0, 0, 0, 255}, bg = {255, 255, 255, 255};
+    lierre_reso_t res;
+    lierre_writer_t *writer;
+    lierre_rgb_data_t *rgb;
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_reader_result_t *result = NULL;
+    const uint8_t *rgba;
+    uint8_t *rgb_data;
+    char text[16];
+    size_t columns = 4, cell = 0, margin = 16, canvas, i, x, y, offset_x, offset_y, src_idx, dst_idx;
+    uint32_t found[16] = {0};
+    unsigned int index;
+
+    /* 16 codes carry 48 capstones, more than the old fixed-size table of 32 could hold. */
+    canvas = 0;
+    rgb_data = NULL;
+    for (i = 0; i < columns * columns; i++) {
+        snprintf(text, sizeof(text), "SHEET_%02u", (unsigned int)i);
+        lierre_writer_param_init(&wparam, (uint8_t *)text, strlen(text), 3, 2, ECC_MEDIUM, MASK_AUTO, MODE_BYTE);
+        TEST_ASSERT_TRUE(lierre_writer_get_res(&wparam, &res));
+        writer = lierre_writer_create(&wparam, &fill, &bg);
+        TEST_ASSERT_NOT_NULL(writer);
+        TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_writer_write(writer));
+        rgba = lierre_writer_get_rgba_data(writer);
+
+        if (!rgb_data) {
+            cell = res.width;
+            canvas = margin + columns * (cell + margin);
+            rgb_data = (uint8_t *)malloc(canvas * canvas * 3);
+            TEST_ASSERT_NOT_NULL(rgb_data);
+            memset(rgb_data, 255, canvas * canvas * 3);
+        }
+        TEST_ASSERT_EQUAL(cell, res.width);
+
+        offset_x = margin + (i % columns) * (cell + margin);
+        offset_y = margin + (i / columns) * (cell + margin);
+        for (y = 0; y < cell; y++) {
+            for (x = 0; x < cell; x++) {
+                src_idx = (y * cell + x) * 4;
+                dst_idx = ((offset_y + y) * canvas + offset_x + x) * 3;
+                memcpy(&rgb_data[dst_idx], &rgba[src_idx], 3);
+            }
+        }
+
+        lierre_writer_destroy(writer);
+    }
+
+    rgb = lierre_rgb_create(rgb_data, canvas * canvas * 3, canvas, canvas);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    lierre_reader_param_init(&param);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(reader, rgb);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read(reader, &result));
+    TEST_ASSERT_EQUAL_UINT32(columns * columns, lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_EQUAL(LIERRE_READER_LIMIT_NONE, lierre_reader_result_get_limits_hit(result));
+
+    for (i = 0; i < columns * columns; i++) {
+        TEST_ASSERT_EQUAL(1, sscanf((const char *)lierre_reader_result_get_qr_code_data(result, (uint32_t)i),
+                                    "SHEET_%u", &index));
+        TEST_ASSERT_TRUE(index < columns * columns);
+        found[index]++;
+    }
+    for (i = 0; i < columns * columns; i++) {
+        TEST_ASSERT_EQUAL_UINT32(1, found[i]);
+    }
+
+    lierre_reader_result_destroy(result);
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(rgb);
+    free(rgb_data);
+}
+
+void test_reader_read_with_executor(void)
+{
+    const char *texts[4] = {"EXEC_1", "EXEC_2", "EXEC_3", "EXEC_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb;
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_reader_result_t *result = NULL;
+    test_executor_ctx_t ctx = {0, 0};
+    lierre_error_t err;
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_MT);
+    lierre_reader_param_set_executor(&param, test_executor, &ctx);
+    lierre_reader_param_set_max_parallelism(&param, 2);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(reader, rgb);
+    err = lierre_reader_read(reader, &result);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
+    TEST_ASSERT_EQUAL_UINT32(4, lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_TRUE(ctx.calls > 0);
+    TEST_ASSERT_EQUAL_UINT32(2, ctx.max_tasks);
+
+    lierre_reader_result_destroy(result);
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(rgb);
+}
+
+void test_reader_read_with_executor_across_stripes(void)
+{
+    const char *texts[4] = {"STRIPE_1", "STRIPE_2", "STRIPE_3", "STRIPE_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb;
+    lierre_reader_param_t param;
+    lierre_reader_t *serial_reader, *reader;
+    lierre_reader_result_t *serial_result = NULL, *result = NULL;
+    test_executor_ctx_t ctx = {0, 0};
+    uint32_t i;
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    lierre_reader_param_init(&param);
+    serial_reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(serial_reader);
+
+    /* Four stripes put seams through every code; the test executor also runs them in reverse. */
+    lierre_reader_param_set_flag(&param, LIERRE_READER_STRATEGY_MT);
+    lierre_reader_param_set_executor(&param, test_executor, &ctx);
+    lierre_reader_param_set_max_parallelism(&param, 4);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    lierre_reader_set_data(serial_reader, rgb);
+    lierre_reader_set_data(reader, rgb);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read(serial_reader, &serial_result));
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read(reader, &result));
+    TEST_ASSERT_EQUAL_UINT32(4, lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_EQUAL_UINT32(lierre_reader_result_get_num_qr_codes(serial_result),
+                             lierre_reader_result_get_num_qr_codes(result));
+    TEST_ASSERT_EQUAL_UINT32(4, ctx.max_tasks);
+
+    for (i = 0; i < lierre_reader_result_get_num_qr_codes(result); i++) {
+        TEST_ASSERT_EQUAL(lierre_reader_result_get_qr_code_data_size(serial_result, i),
+                          lierre_reader_result_get_qr_code_data_size(result, i));
+        TEST_ASSERT_EQUAL_MEMORY(lierre_reader_result_get_qr_code_data(serial_result, i),
+                                 lierre_reader_result_get_qr_code_data(result, i),
+                                 lierre_reader_result_get_qr_code_data_size(result, i));
+    }
+
+    lierre_reader_result_destroy(serial_result);
+    lierre_reader_result_destroy(result);
+    lierre_reader_destroy(serial_reader);
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(rgb);
+}
+
+static inline void read_batch_test(lierre_reader_strategy_flag_t flags, lierre_reader_executor_t executor,
+                                   void *executor_ctx)
+{
+    const char *texts[4] = {"BATCH_1", "BATCH_2", "BATCH_3", "BATCH_4"};
+    lierre_rect_t positions[4];
+    lierre_rgb_data_t *rgb, *blank, *images[7];
+    lierre_reader_result_t *results[7];
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_error_t err;
+    uint8_t blank_data[64 * 48 * 3];
+    int i, round;
+
+    rgb = generate_four_qr_image(texts, positions);
+    TEST_ASSERT_NOT_NULL(rgb);
+
+    memset(blank_data, 255, sizeof(blank_data));
+    blank = lierre_rgb_create(blank_data, sizeof(blank_data), 64, 48);
+    TEST_ASSERT_NOT_NULL(blank);
+
+    for (i = 0; i < 7; i++) {
+        images[i] = (i % 2 == 0) ? rgb : blank;
+    }
+
+    lierre_reader_param_init(&param);
+    lierre_reader_param_set_flag(&param, flags);
+    lierre_reader_param_set_executor(&param, executor, executor_ctx);
+    lierre_reader_param_set_max_parallelism(&param, 3);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    for (round = 0; round < 2; round++) {
+        err = lierre_reader_read_batch(reader, images, 7, results);
+        TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, err);
+
+        for (i = 0; i < 7; i++) {
+            TEST_ASSERT_NOT_NULL(results[i]);
+            TEST_ASSERT_EQUAL_UINT32((i % 2 == 0) ? 4 : 0, lierre_reader_result_get_num_qr_codes(results[i]));
+            lierre_reader_result_destroy(results[i]);
+        }
+    }
+
+    images[3] = NULL;
+    err = lierre_reader_read_batch(reader, images, 7, results);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_INVALID_PARAMS, err);
+    TEST_ASSERT_NULL(results[3]);
+    for (i = 0; i < 7; i++) {
+        if (i != 3) {
+            TEST_ASSERT_NOT_NULL(results[i]);
+        }
+        lierre_reader_result_destroy(results[i]);
+    }
+
+    lierre_reader_destroy(reader);
+    lierre_rgb_destroy(blank);
+    lierre_rgb_destroy(rgb);
+}
+
+void test_reader_read_batch(void)
+{
+    read_batch_test(LIERRE_READER_STRATEGY_NONE, NULL, NULL);
+}
+
+void test_reader_read_batch_mt(void)
+{
+    read_batch_test(LIERRE_READER_STRATEGY_MT, NULL, NULL);
+}
+
+void test_reader_read_batch_with_executor(void)
+{
+    test_executor_ctx_t ctx = {0, 0};
+
+    read_batch_test(LIERRE_READER_STRATEGY_MT, test_executor, &ctx);
+    TEST_ASSERT_TRUE(ctx.calls > 0);
+    TEST_ASSERT_EQUAL_UINT32(3, ctx.max_tasks);
+}
+
+void test_reader_read_batch_invalid(void)
+{
+    lierre_reader_param_t param;
+    lierre_reader_t *reader;
+    lierre_rgb_data_t *images[1] = {NULL};
+    lierre_reader_result_t *results[1];
+
+    lierre_reader_param_init(&param);
+    reader = lierre_reader_create(&param);
+    TEST_ASSERT_NOT_NULL(reader);
+
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_INVALID_PARAMS, lierre_reader_read_batch(NULL, images, 1, results));
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_INVALID_PARAMS, lierre_reader_read_batch(reader, NULL, 1, results));
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_INVALID_PARAMS, lierre_reader_read_batch(reader, images, 1, NULL));
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_reader_read_batch(reader, images, 0, results));
+
+    lierre_reader_destroy(reader);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -898,6 +1562,11 @@ int main(void)
     RUN_TEST(test_reader_param_set_rect_null_param);
     RUN_TEST(test_reader_param_set_rect_null_rect);
 
+    RUN_TEST(test_reader_param_set_executor_basic);
+    RUN_TEST(test_reader_param_set_executor_null);
+    RUN_TEST(test_reader_param_set_max_parallelism);
+    RUN_TEST(test_reader_param_set_limits);
+
     RUN_TEST(test_reader_create_basic);
     RUN_TEST(test_reader_create_null);
     RUN_TEST(test_reader_create_with_flags);
@@ -919,6 +1588,7 @@ int main(void)
     RUN_TEST(test_reader_result_get_qr_code_rect_null);
     RUN_TEST(test_reader_result_get_qr_code_data_null);
     RUN_TEST(test_reader_result_get_qr_code_data_size_null);
+    RUN_TEST(test_reader_result_get_num_finder_candidates_null);
 
     RUN_TEST(test_reader_with_simple_rgb_data);
     RUN_TEST(test_reader_read_with_rect_strategy);
@@ -939,6 +1609,19 @@ int main(void)
 
     RUN_TEST(test_reader_four_qr_read_single_with_rect);
     RUN_TEST(test_reader_four_qr_read_all_without_rect);
+    RUN_TEST(test_reader_reuse_across_reads);
+    RUN_TEST(test_reader_rejects_vertical_stripes_early);
+    RUN_TEST(test_reader_read_with_limits);
+    RUN_TEST(test_reader_read_lazy_refine);
+    RUN_TEST(test_reader_read_overlapping_triples);
+    RUN_TEST(test_reader_read_dense_sheet);
+    RUN_TEST(test_reader_read_with_executor);
+    RUN_TEST(test_reader_read_with_executor_across_stripes);
+
+    RUN_TEST(test_reader_read_batch);
+    RUN_TEST(test_reader_read_batch_mt);
+    RUN_TEST(test_reader_read_batch_with_executor);
+    RUN_TEST(test_reader_read_batch_invalid);
 
     return UNITY_END();
 }
@@ -137,6 +137,17 @@ void test_writer_param_init_all_mask_patterns(void)
                       lierre_writer_param_init(&param, data, 4, 1, 1, ECC_LOW, MASK_7, MODE_BYTE));
 }
 
+void test_writer_param_init_invalid_mask(void)
+{
+    lierre_writer_param_t param;
+    uint8_t data[] = "Test";
+
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_INVALID_PARAMS,
+                      lierre_writer_param_init(&param, data, 4, 1, 1, ECC_LOW, (lierre_writer_mask_t)8, MODE_BYTE));
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_INVALID_PARAMS,
+                      lierre_writer_param_init(&param, data, 4, 1, 1, ECC_LOW, (lierre_writer_mask_t)-2, MODE_BYTE));
+}
+
 void test_writer_param_init_various_scales(void)
 {
     lierre_writer_param_t param;
@@ -604,6 +615,21 @@ void test_writer_write_binary_data(void)
     lierre_writer_destroy(writer);
 }
 
+void test_writer_write_invalid_mask(void)
+{
+    lierre_rgba_t fill = {0, 0, 0, 255}, bg = {255, 255, 255, 255};
+    lierre_writer_param_t param;
+    lierre_writer_t *writer;
+    uint8_t data[] = "hello";
+
+    lierre_writer_param_init(&param, data, 5, 1, 0, ECC_LOW, MASK_AUTO, MODE_BYTE);
+    param.mask_pattern = (lierre_writer_mask_t)8;
+    writer = lierre_writer_create(&param, &fill, &bg);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_NOT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_writer_write(writer));
+    lierre_writer_destroy(writer);
+}
+
 void test_writer_write_max_version_1_data(void)
 {
     lierre_rgba_t fill = {0, 0, 0, 255}, bg = {255, 255, 255, 255};
@@ -664,6 +690,43 @@ void test_writer_write_larger_version(void)
     lierre_writer_destroy(writer);
 }
 
+void test_writer_write_repeat_after_other_version(void)
+{
+    lierre_rgba_t fill = {0, 0, 0, 255}, bg = {255, 255, 255, 255};
+    lierre_writer_param_t small_param, large_param;
+    lierre_writer_t *writer;
+    uint8_t small_data[] = "Template reuse", large_data[300], *first;
+    size_t size;
+
+    memset(large_data, 'Y', sizeof(large_data));
+    lierre_writer_param_init(&small_param, small_data, strlen((char *)small_data), 1, 0, ECC_LOW, MASK_AUTO,
+                             MODE_BYTE);
+    lierre_writer_param_init(&large_param, large_data, sizeof(large_data), 1, 0, ECC_LOW, MASK_AUTO, MODE_BYTE);
+
+    writer = lierre_writer_create(&small_param, &fill, &bg);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_writer_write(writer));
+    size = lierre_writer_get_rgba_data_size(writer);
+    first = (uint8_t *)malloc(size);
+    TEST_ASSERT_NOT_NULL(first);
+    memcpy(first, lierre_writer_get_rgba_data(writer), size);
+    lierre_writer_destroy(writer);
+
+    writer = lierre_writer_create(&large_param, &fill, &bg);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_writer_write(writer));
+    lierre_writer_destroy(writer);
+
+    writer = lierre_writer_create(&small_param, &fill, &bg);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_EQUAL(LIERRE_ERROR_SUCCESS, lierre_writer_write(writer));
+    TEST_ASSERT_EQUAL(size, lierre_writer_get_rgba_data_size(writer));
+    TEST_ASSERT_EQUAL_MEMORY(first, lierre_writer_get_rgba_data(writer), size);
+    lierre_writer_destroy(writer);
+
+    free(first);
+}
+
 void test_writer_write_combined_params(void)
 {
     lierre_rgba_t fill = {32, 64, 128, 200}, bg = {240, 230, 220, 255};
@@ -1121,6 +1184,7 @@ int main(void)
     RUN_TEST(test_writer_param_init_zero_scale);
     RUN_TEST(test_writer_param_init_all_ecc_levels);
     RUN_TEST(test_writer_param_init_all_mask_patterns);
+    RUN_TEST(test_writer_param_init_invalid_mask);
     RUN_TEST(test_writer_param_init_various_scales);
     RUN_TEST(test_writer_param_init_various_margins);
 
@@ -1163,9 +1227,11 @@ int main(void)
     RUN_TEST(test_writer_write_various_margins);
     RUN_TEST(test_writer_write_different_colors);
     RUN_TEST(test_writer_write_binary_data);
+    RUN_TEST(test_writer_write_invalid_mask);
     RUN_TEST(test_writer_write_max_version_1_data);
     RUN_TEST(test_writer_write_version_2_data);
     RUN_TEST(test_writer_write_larger_version);
+    RUN_TEST(test_writer_write_repeat_after_other_version);
     RUN_TEST(test_writer_write_combined_params);
     RUN_TEST(test_writer_version_boundary_byte_mode);
     RUN_TEST(test_writer_version_boundary_all_ecc);